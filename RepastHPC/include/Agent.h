@@ -27,14 +27,24 @@
 #define AGENT
 
 #include <fftw3.h>
+#include <stdint.h>
+#include <boost/serialization/array.hpp>
 #include "repast_hpc/AgentId.h"
 #include "repast_hpc/SharedContext.h"
 #include "repast_hpc/SharedDiscreteSpace.h"
+#include "FFTPlanCache.h"
+#include "CounterRNG.h"
+#include "AgentTable.h"
+#include "CellGrid.h"
+#include "AgentPool.h"
+#include "ModelParameters.h"
 
 //1. Model parameter selection
+//Compiled in defaults, the model.* keys of model.props override them at startup (ModelParameters)
 
 //-Size of communication message:
 // Select the desired value of COM_BUFFER_SIZE at RepastHPC/include/Agent.h
+// It is also the largest model.com.buffer.size accepted from model.props
 #define COM_BUFFER_SIZE 256
 //#define COM_BUFFER_SIZE 64
 //#define COM_BUFFER_SIZE 32
@@ -67,81 +77,194 @@
 #define CENTER_DEATH_Y 50
 
 
+class RepastHPCAgent;
+struct RepastHPCAgentPackage;
+struct RepastHPCAgentDelta;
+
+/* Agent fields that changed since the last ghost state exchange */
+enum DirtyField {
+    DIRTY_RANK  = 1,
+    DIRTY_C     = 2,
+    DIRTY_TOTAL = 4,
+    DIRTY_ALL   = DIRTY_RANK | DIRTY_C | DIRTY_TOTAL
+};
+
+/* Reusable storage of the agent actions, one per thread, so that a step does not allocate */
+struct AgentScratch {
+    std::vector<int>			loc;
+    std::vector<RepastHPCAgent*>	candidates;
+    std::vector<RepastHPCAgent*>	inCircle;
+    std::vector<uint64_t>		keys;
+    std::vector<uint64_t>		ranks;
+};
+
+
 /* Agents */
 class RepastHPCAgent{
 	
 private:
+    static uint32_t	seed;
+    static uint32_t	tick;
+    static ModelParameters params;
+    static uint32_t	epoch;
+
     repast::AgentId   	id_;
+    uint64_t		key;
     double              c;
     double          	total;
+    double		cPayoff;
+    double		totalPayoff;
     char		m[COM_BUFFER_SIZE];
-    std::string 	initialFFTVectorFile;
     int 		N;
-    fftw_complex 	*out;
     fftw_complex 	*in;
+    AgentHandle		handle;
+    CellHandle		cellHandle;
+    uint8_t		dirty;
+    uint32_t		dirtyEpoch;
 	
 public:
-    RepastHPCAgent(repast::AgentId id, int N, fftw_complex *in);
+    RepastHPCAgent(repast::AgentId id, uint64_t key, int N, fftw_complex *in);
 	RepastHPCAgent(){}
-    RepastHPCAgent(repast::AgentId id, double newC, double newTotal, char newm[], int N, fftw_complex *in);
+    RepastHPCAgent(repast::AgentId id, uint64_t key, double newC, double newTotal, const char newm[], int N, fftw_complex *in);
 	
     ~RepastHPCAgent();
+
+    /* Agents live in AgentPool slabs: created with new (pool) RepastHPCAgent(...) and deleted as usual */
+    static void* operator new(size_t size, AgentPool& pool){	return pool.allocate(); }
+    static void operator delete(void* p, AgentPool& pool){	pool.release(p); }
+    static void operator delete(void* p){			AgentPool::free(p); }
 	
     /* Required Getters */
     virtual repast::AgentId& getId(){                   return id_;    }
     virtual const repast::AgentId& getId() const {      return id_;    }
     void getm(char newm[]);
+    void getPackage(RepastHPCAgentPackage& package);
+    void getDelta(RepastHPCAgentDelta& delta);
 	
     /* Getters specific to this kind of Agent */
     double getC(){                                      return c;      }
     double getTotal(){                                  return total;  }
+    uint64_t getKey(){					return key;    }
     int getN(){						return N;}
+    fftw_complex* getIn(){				return in;}
+    AgentHandle getHandle(){				return handle;}
+    CellHandle getCellHandle(){				return cellHandle;}
 	
     /* Setter */
     void set(int currentRank, double newC, double newTotal);
+    void set(const RepastHPCAgentDelta& delta);
     void setm(char newm[]);
+    void setHandle(AgentHandle newHandle){		handle = newHandle;}
+    void setCellHandle(CellHandle newHandle){		cellHandle = newHandle;}
+
+    /* Dirty bits, cleared all at once by nextEpoch() after every ghost state exchange */
+    void markDirty(uint8_t fields){			if (dirtyEpoch != epoch){ dirty = 0; dirtyEpoch = epoch; } dirty |= fields; }
+    uint8_t dirtyFields(){				return (dirtyEpoch == epoch ? dirty : 0); }
+    static void nextEpoch(){				epoch++; }
 	
+    /* Model parameters of the run, set once at startup */
+    static void setParameters(const ModelParameters& newParams){	params = newParams; }
+    static const ModelParameters& getParameters(){		return params; }
+
+    /* Random numbers, a function of (key, seed, tick, stream, index) that does not depend on the process layout */
+    static void setStep(uint32_t seed, uint32_t tick);
+    static uint32_t getSeed(){				return seed; }
+    static uint32_t getTick(){				return tick; }
+    double nextDouble(RandomStream stream, uint32_t index = 0){	return CounterRNG::uniform(key, seed, tick, stream, index); }
+    uint64_t birthKey();
+
+    /* Decisions of an agent given its key and location, shared by the agent methods and the agent table loops */
+    static int moveStep(uint64_t key, uint32_t axis){	return CounterRNG::uniform(key, seed, tick, STREAM_MOVE, axis) < 0.5 ? -1 : 1; }
+    static float deathRateFactor(int x, int y);
+    static float birthRateFactor(int x, int y);
+    static bool dies(uint64_t key, int x, int y){	return CounterRNG::uniform(key, seed, tick, STREAM_DIE, 0) < deathRateFactor(x, y); }
+    static bool reproduces(uint64_t key, int x, int y){	return CounterRNG::uniform(key, seed, tick, STREAM_REPRODUCTION, 0) < birthRateFactor(x, y); }
+
     /* Actions */
-    double frand();
+    double frand(uint32_t draw);
     bool isIntoCircle(int x, int y, int xCircle, int yCircle, int rCircle);    
-    void compute();
-    bool cooperate();                                                 // Will indicate whether the agent cooperates or not; probability determined by = c / total
+    void compute(FFTPlanCache* plans, int slot = 0);
+    void reduceFFT(fftw_complex *out);
+    uint64_t selectRank(uint64_t opponentKey){		return CounterRNG::bits(key, seed, tick, STREAM_SELECT, CounterRNG::digest(opponentKey)); }
+    bool cooperate(uint64_t opponentKey);                             // Will indicate whether the agent cooperates or not; probability determined by = c / total
+    void play(repast::SharedContext<RepastHPCAgent>* context,
+              repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, AgentScratch& scratch);    // Choose three other agents from the given context and see if they cooperate or not
     void play(repast::SharedContext<RepastHPCAgent>* context,
-              repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space);    // Choose three other agents from the given context and see if they cooperate or not
+              repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, int x, int y, AgentScratch& scratch);
+
+    /* Same play with the neighbors taken from the cell grid. Specialized for common (radius, max agents to play)
+       pairs so the hot loop works on constants, playCells<0, 0> takes both from the run parameters */
+    typedef void (RepastHPCAgent::*PlayKernel)(CellGrid* cells, int x, int y, AgentScratch& scratch);
+    template<int RADIUS, int MAX_PLAY>
+    void playCells(CellGrid* cells, int x, int y, AgentScratch& scratch);
+    static PlayKernel playKernel(int radius, int maxAgentsToPlay, bool* specialized = nullptr);
+    void commitPlay();                                                // Apply the payoff of the last play, once every agent has played
+    void nextLocation(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, std::vector<int>& agentNewLoc);
     void move(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space);
-    bool die(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space);
-    bool reproduction(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space);
+    bool die(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, std::vector<int>& agentLoc);
+    bool reproduction(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, std::vector<int>& agentLoc);
     
 };
 
-/* Serializable Agent Package */
-struct RepastHPCAgentPackage {
+/* Fixed layout part of an agent package, sent as raw bytes (same binary on every process) */
+struct RepastHPCAgentPackageHeader {
+    int    id;
+    int    rank;
+    int    type;
+    int    currentRank;
+    uint64_t key;
+    double c;
+    double total;
+    int    N;
+    int    mlen;	// bytes of m in use, model.com.buffer.size
+};
+
+/* Serializable delta of the agent state: AgentId fields, the dirty bits and
+   only the fields they flag */
+struct RepastHPCAgentDelta {
 	
 public:
     int    id;
     int    rank;
     int    type;
+    uint8_t fields;
     int    currentRank;
     double c;
     double total;
+
+    /* For archive packaging */
+    template<class Archive>
+    void serialize(Archive &ar, const unsigned int version){
+        ar & id;
+        ar & rank;
+        ar & type;
+        ar & fields;
+        if (fields & DIRTY_RANK)  ar & currentRank;
+        if (fields & DIRTY_C)     ar & c;
+        if (fields & DIRTY_TOTAL) ar & total;
+    }
+};
+
+/* Serializable Agent Package */
+struct RepastHPCAgentPackage : public RepastHPCAgentPackageHeader {
+	
+public:
     char	m[COM_BUFFER_SIZE];
-    int    N;
 	
     /* Constructors */
     RepastHPCAgentPackage(); // For serialization
-    RepastHPCAgentPackage(int _id, int _rank, int _type, int _currentRank, double _c, double _total, char _m[], int _N);
+    RepastHPCAgentPackage(int _id, int _rank, int _type, int _currentRank, uint64_t _key, double _c, double _total, char _m[], int _N);
+
+    /* Flat wire format: header bytes followed by the mlen bytes of m */
+    size_t wireSize() const {				return sizeof(RepastHPCAgentPackageHeader) + mlen; }
+    char* pack(char* buffer) const;
+    const char* unpack(const char* buffer);
 	
-    /* For archive packaging */
+    /* For archive packaging, two contiguous blocks instead of one archive call per field */
     template<class Archive>
     void serialize(Archive &ar, const unsigned int version){
-        ar & id;
-        ar & rank;
-        ar & type;
-        ar & currentRank;
-        ar & c;
-        ar & total;
-        ar & m;
-	ar & N;
+        ar & boost::serialization::make_array((char*)static_cast<RepastHPCAgentPackageHeader*>(this), sizeof(RepastHPCAgentPackageHeader));
+        ar & boost::serialization::make_array(m, mlen);	// only the model.com.buffer.size bytes in use
     }
 };
 
@@ -0,0 +1,83 @@
+/* AgentPool.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AGENT_POOL
+#define AGENT_POOL
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <boost/mpi.hpp>
+
+//Bytes of a slab, a power of two: slabs are aligned to their size so the slab of an object is found masking its address
+#define AGENT_POOL_SLAB_BYTES (1 << 16)
+
+
+/* Slab allocator of fixed size objects of a process. Freed slots go to a free
+   list and are handed out again before a new slab is taken; slabs are only
+   returned to the system when the pool is destroyed. Not thread safe, agents
+   are created and deleted by the main thread.
+   An object stays in the pool it was created from for its whole life, also
+   when its role changes (a ghost promoted in place by a migration, a local
+   agent kept as ghost after leaving), so the objects of a pool are not the
+   agents of a role. The agents of the role of the pool are counted apart,
+   through countRole. */
+class AgentPool{
+
+private:
+    struct Slab {
+	AgentPool*	owner;
+    };
+
+    std::string		name;
+    size_t		slotBytes;
+    size_t		firstSlot;
+    size_t		slotsPerSlab;
+    std::vector<void*>	slabs;
+    void*		freeList;
+    size_t		inUse;
+    size_t		highWater;
+    size_t		roleInUse;	// agents of the role of the pool, whatever pool they come from
+    size_t		roleHighWater;
+
+    void grow();
+
+public:
+    AgentPool(std::string name, size_t objectBytes);
+    ~AgentPool();
+
+    void* allocate();
+    void release(void* p);
+    static void free(void* p);
+
+    size_t size(){					return inUse; }
+    size_t capacity(){					return slabs.size() * slotsPerSlab; }
+    size_t highWaterMark(){				return highWater; }
+    void countRole(size_t n){				roleInUse = n; if (n > roleHighWater) roleHighWater = n; }
+
+    void report(boost::mpi::communicator* comm);
+};
+
+
+#endif
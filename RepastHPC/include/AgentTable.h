@@ -0,0 +1,88 @@
+/* AgentTable.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef AGENT_TABLE
+#define AGENT_TABLE
+
+#include <stdint.h>
+#include <vector>
+#include "repast_hpc/AgentId.h"
+#include "repast_hpc/SharedContext.h"
+#include "repast_hpc/SharedDiscreteSpace.h"
+
+class RepastHPCAgent;
+
+/* Stable reference to a table entry, valid until the entry is removed */
+struct AgentHandle {
+    uint32_t slot;
+    uint32_t generation;
+
+    AgentHandle(): slot(UINT32_MAX), generation(0){}
+};
+
+
+/* Columnar store of the local agents of a process. Rows are dense (removal
+   moves the last row into the hole), handles stay valid across moves. The
+   agent objects owned by SharedContext stay the reference for Repast, and
+   keep the communication buffer m, set once when the agent is created and
+   read only when its package is built. */
+class AgentTable{
+
+private:
+    /* Hot columns */
+    std::vector<RepastHPCAgent*>	agent;
+    std::vector<repast::AgentId>	id;
+    std::vector<uint64_t>		key;
+    std::vector<int>			x;
+    std::vector<int>			y;
+
+    /* Handles */
+    std::vector<uint32_t>		rowSlot;
+    std::vector<uint32_t>		slotRow;
+    std::vector<uint32_t>		slotGeneration;
+    std::vector<uint32_t>		freeSlots;
+    std::vector<char>			seen;
+    std::vector<int>			agentLoc;
+
+public:
+    AgentTable();
+
+    size_t size(){					return agent.size(); }
+    RepastHPCAgent** getAgent(){			return agent.data(); }
+    int* getX(){					return x.data(); }
+    int* getY(){					return y.data(); }
+    uint64_t* getKey(){					return key.data(); }
+
+    bool valid(AgentHandle handle);
+    size_t row(AgentHandle handle){			return slotRow[handle.slot]; }
+
+    AgentHandle add(RepastHPCAgent* a, int ax, int ay);
+    void remove(size_t row);
+    void sync(repast::SharedContext<RepastHPCAgent>* context,
+              repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space);
+};
+
+
+#endif
@@ -0,0 +1,103 @@
+/* CellGrid.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CELL_GRID
+#define CELL_GRID
+
+#include <stdint.h>
+#include <vector>
+#include "repast_hpc/SharedContext.h"
+#include "repast_hpc/SharedDiscreteSpace.h"
+
+class RepastHPCAgent;
+
+/* Position of an agent in the cell grid, kept by the agent itself */
+struct CellHandle {
+    int32_t  cell;
+    uint32_t slot;
+
+    CellHandle(): cell(-1), slot(0){}
+};
+
+/* Agent as seen by the neighbor queries */
+struct CellEntry {
+    RepastHPCAgent*	agent;
+    int			x;
+    int			y;
+    uint64_t		key;
+    uint32_t		stamp;
+};
+
+
+/* Uniform grid of square cells over the local bounds of the process widened
+   by the interaction radius, holding local and ghost agents. Cells visited by
+   a query come from a disk stencil of cell offsets, so the corners of the
+   bounding square of the radius are never scanned. */
+class CellGrid{
+
+private:
+    int					radius;
+    int					cellSize;
+    int					originX, originY;
+    int					cellsX, cellsY;
+    uint32_t				stamp;
+    std::vector<std::vector<CellEntry> >	cells;
+    std::vector<int>			stencilX;
+    std::vector<int>			stencilY;
+    std::vector<int>			agentLoc;
+
+    int cellOf(int x, int y);
+
+public:
+    CellGrid(int radius, int cellSize);
+
+    void setBounds(const repast::GridDimensions& bounds);
+
+    void update(repast::SharedContext<RepastHPCAgent>* context,
+                repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space);
+
+    /* Call f(entry) for every agent at squared distance RADIUS^2 or less of (x, y), no allocation.
+       RADIUS is at most the radius of the grid, 0 uses the radius of the grid */
+    template<int RADIUS, typename F>
+    void forEachInRadius(int x, int y, F f){
+        int cx = (x - originX) / cellSize;
+        int cy = (y - originY) / cellSize;
+        const int r2 = (RADIUS > 0 ? RADIUS * RADIUS : radius * radius);
+
+        for (size_t s=0; s<stencilX.size(); s++){
+            int sx = cx + stencilX[s];
+            int sy = cy + stencilY[s];
+            if (sx < 0 || sy < 0 || sx >= cellsX || sy >= cellsY) continue;
+
+            const std::vector<CellEntry>& cell = cells[sy * cellsX + sx];
+            for (size_t i=0; i<cell.size(); i++){
+                int dx = cell[i].x - x;
+                int dy = cell[i].y - y;
+                if (dx*dx + dy*dy <= r2) f(cell[i]);
+            }
+        }
+    }
+};
+
+
+#endif
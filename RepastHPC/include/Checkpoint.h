@@ -0,0 +1,105 @@
+/* Checkpoint.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHECKPOINT
+#define CHECKPOINT
+
+#include <mpi.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define CHECKPOINT_MAGIC "ABMSCKP1"
+#define CHECKPOINT_VERSION 1
+
+/* File header. It is followed by the rank index, one CheckpointRankEntry per
+   process that wrote the checkpoint, and by the records of every process one
+   after the other. Values are in the byte order of the machine that wrote it. */
+struct CheckpointHeader {
+    char	magic[8];
+    uint32_t	version;
+    uint32_t	seed;		// run seed, with the tick the whole state of the random streams
+    int32_t	tick;		// last tick run
+    int32_t	ranks;		// processes that wrote the checkpoint
+    int32_t	comBufferSize;	// bytes of m in every record
+    int32_t	recordBytes;	// bytes of a record, CheckpointRecord and m
+    uint64_t	records;
+    char	reserved[24];
+};
+
+/* Where the records of a process are, and its agent counter */
+struct CheckpointRankEntry {
+    uint64_t	first;		// first record of the process
+    uint64_t	records;
+    int64_t	countOfAgents;	// next AgentId number of the process
+};
+
+/* A local agent, followed by its comBufferSize bytes of m */
+struct CheckpointRecord {
+    int32_t	id;		// AgentId, kept on restart so ids stay unique
+    int32_t	startingRank;
+    int32_t	type;
+    int32_t	x;
+    int32_t	y;
+    int32_t	pad;
+    uint64_t	key;
+    double	c;
+    double	total;
+};
+
+
+/* Checkpoint of the simulation state to one shared file with MPI-IO. A
+   process packs its agents into its own buffer and the write is left in
+   flight (nonblocking MPI-IO) while the simulation goes on; it is completed
+   before the next checkpoint or at the end of the run. The file is written
+   as file.part and renamed once complete, so a run killed while writing
+   keeps the previous checkpoint. */
+class Checkpoint{
+
+private:
+    MPI_Comm			comm;
+    int				rank;
+    int				size;
+    std::string			file;
+    bool			pending;
+    MPI_File			fh;
+    std::vector<MPI_Request>	requests;
+    std::vector<char>		buffer;
+    CheckpointHeader		header;
+    CheckpointRankEntry		entry;
+
+public:
+    Checkpoint(MPI_Comm comm, const std::string& file);
+    ~Checkpoint();
+
+    static size_t recordBytes(int comBufferSize);
+
+    char* pack(size_t records, int comBufferSize);
+    void write(int tick, uint32_t seed, int64_t countOfAgents);
+    void progress();
+    void finish();
+
+    static void restore(MPI_Comm comm, const std::string& file, const int bounds[4], CheckpointHeader& header, int64_t* countOfAgents, std::vector<char>& records);
+};
+
+#endif
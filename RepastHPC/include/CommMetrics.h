@@ -0,0 +1,70 @@
+/* CommMetrics.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMM_METRICS
+#define COMM_METRICS
+
+#include <stdint.h>
+#include <string>
+#include <mpi.h>
+#include <boost/mpi.hpp>
+
+
+/* Exchanges of a tick communication is accounted to */
+enum CommPhase {
+    COMM_OTHER = 0,	// out of any exchange (data collection, reports)
+    COMM_BALANCE,	// Repast space balance
+    COMM_STATUS,	// Repast agent status (migrations)
+    COMM_PROJECTION,	// Repast projection info (ghosts)
+    COMM_STATES,	// Repast agent states (ghost updates)
+    COMM_HALO,		// fused exchange
+    COMM_REBALANCE,	// boundary moves of the fused engine
+    NUM_COMM_PHASES
+};
+
+
+/* Process wide accounting of messages and bytes sent to every peer rank,
+   agent packages sent and received and wall time of the exchanges, per
+   phase and per tick. Messages and bytes are counted by intercepting the MPI
+   sends and collectives of the process through the MPI profiling interface
+   (PMPI), which also sees what Repast and Boost.MPI send. The interception is
+   left out with -DCOMM_NO_INTERCEPT (e.g. to keep TAU's own MPI wrappers),
+   only packages and times are counted then. Nothing is counted until enabled. */
+class CommMetrics{
+
+public:
+    static bool intercepting();
+    static void enable(MPI_Comm comm);
+    static bool enabled();
+    static const char* phaseName(CommPhase phase);
+
+    static void begin(CommPhase phase);
+    static void end();
+    static void packagesSent(size_t n);
+    static void packagesReceived(size_t n);
+    static void endTick(int tick);
+    static void report(boost::mpi::communicator* comm, std::string dir);
+};
+
+
+#endif
@@ -0,0 +1,86 @@
+/* CounterRNG.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef COUNTER_RNG
+#define COUNTER_RNG
+
+#include <stdint.h>
+
+
+/* Random streams of an agent, part of the counter so every use draws independent numbers */
+enum RandomStream {
+    STREAM_COOPERATE = 1,
+    STREAM_MOVE,
+    STREAM_DIE,
+    STREAM_REPRODUCTION,
+    STREAM_BIRTH,
+    STREAM_FRAND,
+    STREAM_SCENARIO,	// initial position of an agent (Scenario)
+    STREAM_FFT_VECTOR,	// FFT input vector, keyed by the value index
+    STREAM_SELECT	// rank of an opponent in play, keyed by the opponent
+};
+
+
+/* Counter based random numbers (Philox4x32-10, Salmon et al. SC'11). A number is a pure
+   function of (agent key, seed, tick, stream, index): no state, same value on any process
+   layout, thread count or iteration order. */
+class CounterRNG{
+
+public:
+    /* 10 Philox rounds on a 128 bit counter with a 64 bit key */
+    static inline void philox(uint32_t ctr[4], uint32_t key0, uint32_t key1){
+	for (int r=0; r<10; r++){
+		uint64_t p0 = (uint64_t)0xD2511F53u * ctr[0];
+		uint64_t p1 = (uint64_t)0xCD9E8D57u * ctr[2];
+		uint32_t c1 = ctr[1], c3 = ctr[3];
+		ctr[0] = (uint32_t)(p1 >> 32) ^ c1 ^ key0;
+		ctr[1] = (uint32_t)p1;
+		ctr[2] = (uint32_t)(p0 >> 32) ^ c3 ^ key1;
+		ctr[3] = (uint32_t)p0;
+		key0 += 0x9E3779B9u;
+		key1 += 0xBB67AE85u;
+	}
+    }
+
+    /* 64 random bits */
+    static inline uint64_t bits(uint64_t key, uint32_t seed, uint32_t tick, uint32_t stream, uint32_t index){
+	uint32_t ctr[4] = { tick, stream, index, seed };
+	philox(ctr, (uint32_t)key, (uint32_t)(key >> 32));
+	return ((uint64_t)ctr[0] << 32) | ctr[1];
+    }
+
+    /* Uniform double in [0,1) with 53 random bits */
+    static inline double uniform(uint64_t key, uint32_t seed, uint32_t tick, uint32_t stream, uint32_t index){
+	return (bits(key, seed, tick, stream, index) >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /* 32 bit digest of a key, used as draw index of pairwise draws */
+    static inline uint32_t digest(uint64_t key){
+	return (uint32_t)key ^ (uint32_t)(key >> 32);
+    }
+};
+
+
+#endif
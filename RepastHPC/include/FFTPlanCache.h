@@ -0,0 +1,66 @@
+/* FFTPlanCache.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef FFT_PLAN_CACHE
+#define FFT_PLAN_CACHE
+
+#include <fftw3.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <boost/mpi.hpp>
+
+
+/* FFTW plans and buffers shared by all agents of a process, keyed by (vector size N, batch size).
+   Every thread of the process owns a slot of input and output buffers. */
+class FFTPlanCache{
+
+private:
+    typedef std::pair<int, int> Key;
+    typedef std::pair<Key, int> Slot;
+
+    unsigned				flags;
+    std::string				wisdomFile;
+    std::map<Key, fftw_plan>		plans;
+    std::map<Slot, fftw_complex*>	inputs;
+    std::map<Slot, fftw_complex*>	buffers;
+
+    fftw_complex* allocate(std::map<Slot, fftw_complex*>& arrays, int N, int howmany, int slot);
+    fftw_plan createPlan(int N, int howmany);
+
+public:
+    FFTPlanCache(std::string plannerMode, std::string wisdomFile);
+    ~FFTPlanCache();
+
+    static unsigned plannerFlags(std::string plannerMode);
+
+    void prepare(int N, int howmany, int slots, boost::mpi::communicator* comm);
+    fftw_plan plan(int N, int howmany = 1);
+    fftw_complex* input(int N, int howmany, int slot = 0);
+    fftw_complex* buffer(int N, int howmany = 1, int slot = 0);
+};
+
+
+#endif
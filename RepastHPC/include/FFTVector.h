@@ -0,0 +1,63 @@
+/* FFTVector.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FFT_VECTOR
+#define FFT_VECTOR
+
+#include <mpi.h>
+#include <fftw3.h>
+#include <string>
+#include "FFTVectorFormat.h"
+
+//Alignment of the shared vector, at least the SIMD alignment of fftw_malloc
+#define FFT_VECTOR_ALIGN 64
+
+
+/* The FFT input vector, read only and the same for every agent. A text file
+   (N, then a "re im" line per value) is parsed by every process into its own
+   copy. A binary file (see FFTVectorFormat.h) is mapped by one process per
+   node, which copies it into an MPI-3 shared memory window the processes of
+   the node read in place. A generated vector is drawn by every process, the
+   same values as gen_file_init writes for the seed. */
+class FFTVector{
+
+private:
+    int			N;
+    fftw_complex*	values;
+    bool		shared;
+    MPI_Comm		node;
+    MPI_Win		window;
+
+    void loadText(const std::string& file);
+    void loadShared(const std::string& file, MPI_Comm comm);
+
+public:
+    FFTVector(const std::string& file, bool binary, MPI_Comm comm);
+    FFTVector(int N, uint32_t seed);
+    ~FFTVector();
+
+    int size(){				return N; }
+    fftw_complex* data(){		return values; }
+};
+
+#endif
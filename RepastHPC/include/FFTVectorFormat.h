@@ -0,0 +1,60 @@
+/* FFTVectorFormat.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FFT_VECTOR_FORMAT
+#define FFT_VECTOR_FORMAT
+
+#include <stdint.h>
+#include <string.h>
+
+//Binary FFT input vector, written by convert_init and mapped by FFTVector
+#define FFT_VECTOR_MAGIC "ABMSFFT1"
+#define FFT_VECTOR_VERSION 1
+
+/* File header, followed by N complex values, two doubles (real, imaginary)
+   each, in the byte order of the machine that wrote it. The header is 64
+   bytes so the values of a mapped file keep the alignment of the page. */
+struct FFTVectorHeader {
+    char	magic[8];
+    uint32_t	version;
+    uint32_t	pad;
+    uint64_t	N;
+    char	reserved[40];
+};
+
+/*
+ * Function: fftVectorValid
+ * --------------------
+ * Check the magic and version of a header
+ * 
+ * h: file header
+ * fileBytes: size of the file
+ *
+ * returns: true if the header is from a file of this version holding its N values
+ */
+inline bool fftVectorValid(const FFTVectorHeader& h, uint64_t fileBytes){
+	return memcmp(h.magic, FFT_VECTOR_MAGIC, sizeof(h.magic)) == 0 && h.version == FFT_VECTOR_VERSION &&
+	       h.N > 0 && fileBytes >= sizeof(FFTVectorHeader) + h.N * 2 * sizeof(double);
+}
+
+#endif
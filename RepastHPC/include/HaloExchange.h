@@ -0,0 +1,227 @@
+/* HaloExchange.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HALO_EXCHANGE
+#define HALO_EXCHANGE
+
+#include <mpi.h>
+#include <vector>
+#include "repast_hpc/AgentId.h"
+#include "repast_hpc/SharedContext.h"
+#include "repast_hpc/SharedDiscreteSpace.h"
+
+#include "Agent.h"
+#include "PayloadCodec.h"
+
+class RepastHPCAgentPackageReceiver;
+
+/* Kinds of record of a halo message, written in this order so that a ghost
+   is removed before the same agent arrives as a migration */
+enum HaloRecordKind {
+    HALO_REMOVE = 0,	// drop the ghost
+    HALO_MIGRATE,	// agent now owned by the receiver, followed by its package
+    HALO_GHOST_NEW,	// first time the receiver sees the ghost, followed by its package
+    HALO_GHOST_UPDATE	// location and counters of a ghost the receiver already has
+};
+
+/* Fixed part of every record, sent as raw bytes (same binary on every process) */
+struct HaloRecord {
+    int    kind;
+    int    id;
+    int    rank;
+    int    type;
+    int    currentRank;
+    int    x;
+    int    y;
+    int    pad;	// zero, keeps the doubles aligned without uninitialized bytes on the wire
+    double c;
+    double total;
+};
+
+/* Agent exported as a ghost to a neighbor */
+struct HaloExport {
+    repast::AgentId	id;
+    RepastHPCAgent*	agent;
+    int			x;
+    int			y;
+    int			owner;	// rank owning the agent once the exchange is applied
+
+    bool operator<(const HaloExport& other) const {	return id < other.id; }
+};
+
+/* Local agent left out of the local bounds by the move phase, where it went */
+struct HaloDeparture {
+    RepastHPCAgent*	agent;
+    int			x;
+    int			y;
+};
+
+
+/* Fused synchronization of a tick: migrations, ghost removals, new ghosts and
+   ghost updates for every neighbor process go in one message, exchanged with
+   one neighborhood collective over the (up to 8) neighbors of the process
+   grid. Owners and neighbors come from the bounds of every process, gathered
+   once. Ghosts sent to each neighbor are remembered to send only what changed
+   in the set: new ghosts carry the whole package, known ones a fixed record.
+   An emigrant is ghosted on behalf of its new owner in the same message, the
+   new owner takes over the ghost from the next exchange.
+
+   With interest management the tick takes three rounds instead: migrations,
+   then every process tells its neighbors which cells of its ghost area are
+   within the play radius of one of its agents, then only the agents in those
+   cells are ghosted.
+
+   Boundaries between process columns and between process rows may move to
+   balance the load (rebalance), processes keep their neighbors.
+
+   With the shared memory transport the message to a neighbor on the same node
+   is written to a slot of an MPI-3 shared window and parsed in place by the
+   neighbor; only its size goes through MPI. Messages to other nodes, and
+   those larger than a slot, are still sent, compressed if a codec is set. */
+class HaloExchange{
+
+private:
+    MPI_Comm				world;
+    MPI_Comm				graph;
+    int					rank;
+    int					width, height;
+    int					buffer;
+    int					originX, originY;
+    int					extentX, extentY;
+    std::vector<int>			startX;		// first x of every process column
+    std::vector<int>			startY;		// first y of every process row
+    std::vector<int>			rankAt;		// rank of (column, row)
+    std::vector<int>			column, row;	// column and row of every rank
+    std::vector<int>			neighbors;	// distinct neighbor ranks
+    std::vector<int>			neighborIndex;	// neighbor index of every rank, -1 if not a neighbor
+    std::vector<std::vector<HaloExport> >	exported;	// ghosts sent to every neighbor, sorted by id
+    std::vector<std::vector<HaloExport> >	exporting;
+    std::vector<std::vector<char> >	out;
+    std::vector<std::vector<char> >	moved;		// migrations, appended to out after the removals
+    std::vector<repast::AgentId>	leaving;
+    std::vector<int>			sendCounts, sendDispls;
+    std::vector<int>			recvCounts, recvDispls;
+    MPI_Request				request;
+    int					stage;		// 0: idle, 1: sizes in flight, 2: messages in flight
+    std::vector<char>			sendBuffer;
+    std::vector<char>			recvBuffer;
+    std::vector<int>			location;
+    std::vector<int>			agentLoc;	// locations of the local agents, x and y
+    std::vector<RepastHPCAgent*>	locals;
+    RepastHPCAgentPackage		package;
+
+    /* Interest management */
+    bool				interest;
+    int					radius;
+    int					interestCell;
+    int					frameCellsX, frameCellsY;	// cells of the ghost frame of this process
+    std::vector<uint8_t>		interestBits;
+    std::vector<int>			interestCounts, interestDispls;
+    std::vector<uint8_t>		neighborInterest;
+
+    /* Load balancing */
+    std::vector<double>			histX, histY;
+    std::vector<std::vector<char> >	bulk;		// bulk migrations to every rank
+    std::vector<int>			bulkCounts, bulkDispls;
+    std::vector<int>			bulkRecvCounts, bulkRecvDispls;
+
+    /* Shared memory transport */
+    bool				shared;
+    MPI_Comm				node;
+    MPI_Win				window;
+    size_t				slotSize;
+    unsigned				generation;	// exchanges applied, the parity selects the half of the slots
+    std::vector<char*>			slotTo;		// slots written for every neighbor, nullptr if off node
+    std::vector<char*>			slotFrom;	// slots of every neighbor read by this process, nullptr if off node
+    std::vector<int>			sendSizes, recvSizes;	// per neighbor: bytes sent, bytes in the slot
+
+    /* Compression of the messages sent through MPI, nullptr if off */
+    PayloadCodec*			codec;
+    std::vector<char>			encoded;
+    std::vector<char>			decoded;
+
+    int columnOrigin(int c){				return startX[c]; }
+    int columnExtent(int c){				return (c + 1 < (int)startX.size() ? startX[c+1] : startX[0] + width) - startX[c]; }
+    int rowOrigin(int r){				return startY[r]; }
+    int rowExtent(int r){				return (r + 1 < (int)startY.size() ? startY[r+1] : startY[0] + height) - startY[r]; }
+
+    void buildGraph(MPI_Comm comm);
+    bool placeCuts(const std::vector<double>& hist, int minExtent, std::vector<int>& start);
+    int ghostTargets(int owner, int x, int y, int* targets);
+    bool interesting(int neighbor, int x, int y);
+    void markInterest();
+    void listLocals(repast::SharedContext<RepastHPCAgent>* context);
+    void putRecord(std::vector<char>& dst, int kind, const repast::AgentId& id, int x, int y, RepastHPCAgent* agent, int owner);
+    void putPackage(std::vector<char>& dst, RepastHPCAgent* agent, int currentRank);
+    void putGhosts(size_t i);
+    void putMigration(RepastHPCAgent* agent, int x, int y, int owner);
+    void flatten();
+    void send();
+    void apply(repast::SharedContext<RepastHPCAgent>* context,
+               repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+               RepastHPCAgentPackageReceiver* receiver, RepastHPCAgentPackageReceiver* ghostReceiver,
+               std::vector<RepastHPCAgent*>* arrivals);
+
+public:
+    HaloExchange(MPI_Comm comm, const repast::GridDimensions& bounds, int width, int height, int buffer);
+    ~HaloExchange();
+
+    void setInterest(int radius, int cellSize);
+    void setSharedTransport(size_t slotSize);
+    void setCodec(PayloadCodec* _codec){		codec = _codec; }
+
+    bool rebalance(repast::SharedContext<RepastHPCAgent>* context,
+                   repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+                   RepastHPCAgentPackageReceiver* receiver, double cost);
+    repast::GridDimensions bounds(){			return repast::GridDimensions(repast::Point<double>(originX, originY), repast::Point<double>(extentX, extentY)); }
+
+    int owner(int x, int y);
+    size_t numNeighbors(){				return neighbors.size(); }
+
+    /* True if the square of half side margin around (x, y) lies inside the local bounds */
+    bool interior(int x, int y, int margin){
+        return x - margin >= originX && x + margin < originX + extentX &&
+               y - margin >= originY && y + margin < originY + extentY;
+    }
+
+    /* Split phase exchange: post() packs and starts it, progress() moves it on
+       once the sizes may have arrived, complete() waits and applies it. With
+       interest management post() runs the first two rounds itself */
+    void post(repast::SharedContext<RepastHPCAgent>* context,
+              repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+              RepastHPCAgentPackageReceiver* receiver, RepastHPCAgentPackageReceiver* ghostReceiver,
+              const std::vector<HaloDeparture>* departures = nullptr);
+    void progress();
+    void complete(repast::SharedContext<RepastHPCAgent>* context,
+                  repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+                  RepastHPCAgentPackageReceiver* receiver, RepastHPCAgentPackageReceiver* ghostReceiver,
+                  std::vector<RepastHPCAgent*>* arrivals = nullptr);
+
+    void exchange(repast::SharedContext<RepastHPCAgent>* context,
+                  repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+                  RepastHPCAgentPackageReceiver* receiver, RepastHPCAgentPackageReceiver* ghostReceiver,
+                  const std::vector<HaloDeparture>* departures = nullptr);
+};
+
+
+#endif
@@ -37,6 +37,16 @@
 #include "repast_hpc/GridComponents.h"
 
 #include "Agent.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "AgentTable.h"
+#include "CellGrid.h"
+#include "RateKernel.h"
+#include "HaloExchange.h"
+#include "PayloadCodec.h"
+#include "FFTVector.h"
+#include "Scenario.h"
+#include "Checkpoint.h"
 
 #include <string>
 
@@ -44,7 +54,7 @@
 //1. Model parameter selection
 
 //-Size of space where agents move arround
-//Select the desired HEIGHT and WIDTH at RepastHPC/include/Model.h
+//Select the desired HEIGHT and WIDTH at RepastHPC/include/Model.h, or model.width and model.height at model.props
 #define HEIGHT 300
 #define WIDTH 300
 
@@ -62,6 +72,8 @@ public:
     void providePackage(RepastHPCAgent * agent, std::vector<RepastHPCAgentPackage>& out);
 	
     void provideContent(repast::AgentRequest req, std::vector<RepastHPCAgentPackage>& out);
+
+    void provideContent(repast::AgentRequest req, std::vector<RepastHPCAgentDelta>& out);
 	
 };
 
@@ -70,14 +82,17 @@ class RepastHPCAgentPackageReceiver {
 	
 private:
     repast::SharedContext<RepastHPCAgent>* agents;
+    AgentPool* agentPool;
 	
 public:
 	
-    RepastHPCAgentPackageReceiver(repast::SharedContext<RepastHPCAgent>* agentPtr);
+    RepastHPCAgentPackageReceiver(repast::SharedContext<RepastHPCAgent>* agentPtr, AgentPool* pool);
 	
-    RepastHPCAgent * createAgent(RepastHPCAgentPackage package);
+    RepastHPCAgent * createAgent(const RepastHPCAgentPackage& package);
 	
-    void updateAgent(RepastHPCAgentPackage package);
+    void updateAgent(const RepastHPCAgentPackage& package);
+
+    void updateAgent(const RepastHPCAgentDelta& delta);
 	
 };
 
@@ -109,15 +124,66 @@ class RepastHPCModel{
 	int procPerx;
 	int procPery;
         int N;
-
+	bool fftBatched;
+	int fftBatchSize;
+	int threadsPerRank;
+	bool soaStore;
+	bool cellEngine;
+	bool batchRates;
+	bool deltaSync;
+	bool fusedSync;
+	bool overlapSync;
+	bool ghostInterest;
+	bool sharedTransport;
+	int balanceEvery;
+	bool balanceByTime;
+	bool imbalanceReport;
+	double workSinceBalance;
+	FILE* imbalanceFile;
+	PayloadCodec* codec;
+	FILE* compressionFile;
+	Checkpoint* checkpoint;
+	int checkpointEvery;
+	std::string restartFile;
+	int startTick;
+
+	bool tiledAgents;
+	bool binaryFFTVector;
+	bool generatedAgents;
+	bool generatedFFTVector;
 	std::string initialAgentsFile;
 	std::string initialFFTVectorFile;
 
 	repast::Properties* props;
+	ModelParameters params;
+	RepastHPCAgent::PlayKernel playKernel;
+	FFTPlanCache* fftPlans;
+	FFTVector* fftVector;
+	Profiler* profiler;
+	ThreadPool* pool;
+	AgentTable* table;
+	CellGrid* cells;
+	RateKernel* rates;
+	HaloExchange* halo;
+	std::vector<int> nextX;
+	std::vector<int> nextY;
+	std::vector<uint64_t> agentKeys;
+	std::vector<char> requests;
+	std::vector<uint32_t> indexes;
+	std::vector<AgentScratch> scratch;
+	std::vector<RepastHPCAgent*> localAgents;
+	std::vector<RepastHPCAgent*> boundaryAgents;
+	std::vector<HaloDeparture> departures;
+	std::vector<int> agentNewLoc;
+	int spaceOrigin[2];
+	int spaceExtent[2];
+	AgentPool localPool;	// Declared before context, the context deletes its agents first
+	AgentPool ghostPool;
 	repast::SharedContext<RepastHPCAgent> context;
 	
 	RepastHPCAgentPackageProvider* provider;
 	RepastHPCAgentPackageReceiver* receiver;
+	RepastHPCAgentPackageReceiver* ghostReceiver;
 
 	repast::SVDataSet* agentValues;
     repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* discreteSpace;
@@ -126,10 +192,30 @@ public:
 	RepastHPCModel(std::string propsFile, int argc, char** argv, boost::mpi::communicator* comm);
 	~RepastHPCModel();
 	void init();
+	void addInitialAgent(uint64_t key, int x, int y, char* m);
+	void generateAgents(float xmin, float ymin, float xmax, float ymax, char* m);
+	ScenarioParameters scenarioParameters();
+	void restoreAgents(float xmin, float ymin, float xmax, float ymax);
+	void saveCheckpoint();
+	void countAgentRoles(size_t local);
+	double resumeAt(double start, double interval);
 	void requestAgents();
 	void cancelAgentRequests();
 	void removeLocalAgents();
 	void printAgentsPosition();
+	int wrap(int v, int dim);
+	void computeBatched(RepastHPCAgent** agents, size_t n);
+	void playObjects(RepastHPCAgent** agents, size_t n);
+	void computeObjects(RepastHPCAgent** agents, size_t n);
+	void stepObjects(std::vector<RepastHPCAgent*>& agents);
+	void stepPopulation(std::vector<RepastHPCAgent*>& agents);
+	void stepOverlapped();
+	void stepTable();
+	bool balanceDue();
+	void balanceLoad();
+	void recordImbalance(double work);
+	void recordCompression();
+	void synchronize();
 	void doSomething();
 	void initSchedule(repast::ScheduleRunner& runner);
 	void recordResults();
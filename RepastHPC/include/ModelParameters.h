@@ -0,0 +1,51 @@
+/* ModelParameters.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODEL_PARAMETERS
+#define MODEL_PARAMETERS
+
+#include "repast_hpc/Properties.h"
+
+
+/* Model parameters of a run. Defaults are the values selected at
+   RepastHPC/include/Agent.h and RepastHPC/include/Model.h, model.props can
+   override any of them without a rebuild. */
+struct ModelParameters {
+    int		comBufferSize;		// bytes of the communication message, up to COM_BUFFER_SIZE
+    int		width;
+    int		height;
+    int		radius;
+    int		maxAgentsToPlay;
+    double	birthRate;
+    double	deathRate;
+    int		centerBirthX;
+    int		centerBirthY;
+    int		centerDeathX;
+    int		centerDeathY;
+
+    ModelParameters();
+    void read(repast::Properties* props);
+};
+
+
+#endif
@@ -0,0 +1,85 @@
+/* PayloadCodec.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PAYLOAD_CODEC
+#define PAYLOAD_CODEC
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//Shortest run of zero bytes taken out of a message, shorter runs stay literal
+#define PAYLOAD_ZERO_RUN_MIN 4
+//Encoded size over raw size above which a message goes raw
+#define PAYLOAD_MAX_RATIO 0.9
+//Messages of a size class sent raw without trying after compression did not pay off
+#define PAYLOAD_RETRY 32
+
+/* Encodings of a message, first byte of the encoded message */
+enum PayloadMethod {
+    PAYLOAD_RAW = 0,	// as given
+    PAYLOAD_ZERO_RUNS,	// zero runs taken out, followed by the raw size
+    PAYLOAD_LZ4		// zero runs taken out and LZ4, followed by the raw and zero run sizes
+};
+
+/* Per tick counters of a codec */
+struct PayloadStats {
+    double	messages;	// messages encoded
+    double	compressed;	// messages not sent raw
+    double	rawBytes;
+    double	wireBytes;
+    double	encodeTime;	// secs
+    double	decodeTime;
+};
+
+
+/* Compression of the messages between processes. Runs of zero bytes (the
+   unused part of the agent communication buffers) are replaced by their
+   length, then, if compiled with HAVE_LZ4 and asked for, the result goes
+   through LZ4. Whether it pays off is decided per size class of the messages
+   (powers of two): messages shorter than minBytes are always sent raw, and a
+   class where the encoded size was not below PAYLOAD_MAX_RATIO of the raw one
+   sends the next PAYLOAD_RETRY messages raw before trying again. */
+class PayloadCodec{
+
+private:
+    bool		lz4;
+    size_t		minBytes;
+    unsigned		skip[64];	// messages of every size class left to send raw
+    std::vector<char>	runs;		// zero run encoding before LZ4
+    PayloadStats	stats;
+
+public:
+    PayloadCodec(bool lz4, size_t minBytes);
+
+    static bool lz4Available();
+
+    void encode(const char* src, size_t n, std::vector<char>& dst);
+    const char* decode(const char* src, size_t n, std::vector<char>& dst, size_t* size);
+
+    const PayloadStats& tickStats(){			return stats; }
+    void resetStats();
+};
+
+
+#endif
@@ -0,0 +1,74 @@
+/* Profiler.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef PROFILER
+#define PROFILER
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <boost/mpi.hpp>
+
+
+/* Timed phases of a simulation step */
+enum Phase {
+    PHASE_TICK = 0,
+    PHASE_PLAY,
+    PHASE_COMPUTE,
+    PHASE_MOVE,
+    PHASE_REPRODUCTION,
+    PHASE_DIE,
+    PHASE_SYNC,
+    NUM_PHASES
+};
+
+
+/* Per process wall time and heap allocation accounting of the simulation phases */
+class Profiler{
+
+private:
+    double			started[NUM_PHASES];
+    double			elapsed[NUM_PHASES];
+    uint64_t			startedAllocs[NUM_PHASES];
+    uint64_t			startedBytes[NUM_PHASES];
+    unsigned long long		allocs[NUM_PHASES];
+    unsigned long long		bytes[NUM_PHASES];
+    int				ticks;
+    std::vector<std::string>	labels;
+
+public:
+    Profiler();
+
+    static const char* phaseName(Phase phase);
+
+    void label(std::string key, std::string value);
+    void start(Phase phase);
+    void stop(Phase phase);
+    double elapsedTime(Phase phase){			return elapsed[phase]; }
+    void report(boost::mpi::communicator* comm, std::string fileName);
+};
+
+
+#endif
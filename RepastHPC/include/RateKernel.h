@@ -0,0 +1,66 @@
+/* RateKernel.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RATE_KERNEL
+#define RATE_KERNEL
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "ThreadPool.h"
+
+
+/* Birth and death decisions of all the local agents of a process at once. Rate
+   factors and random numbers are computed over contiguous arrays in branch
+   free loops the compiler vectorizes, the agents to spawn and to remove are
+   returned as compact ascending index lists. Results are the same as the
+   per-agent RepastHPCAgent::reproduces/dies reference. */
+class RateKernel{
+
+private:
+    std::vector<float>		birthFactor;
+    std::vector<float>		deathFactor;
+    std::vector<double>		birthDraw;
+    std::vector<double>		deathDraw;
+    std::vector<uint32_t>	births;
+    std::vector<uint32_t>	deaths;
+    std::vector<size_t>		blockBegin;
+    std::vector<size_t>		blockBirths;
+    std::vector<size_t>		blockDeaths;
+
+    static size_t pack(std::vector<uint32_t>& list, std::vector<size_t>& counts, std::vector<size_t>& begins);
+
+public:
+    static void rateFactors(const int* x, const int* y, size_t n, int centerX, int centerY, double rate, float* factor);
+    static void uniforms(const uint64_t* key, size_t n, uint32_t seed, uint32_t tick, uint32_t stream, double* u);
+
+    void evaluate(ThreadPool* pool, const uint64_t* key, const int* x, const int* y, size_t n, uint32_t seed, uint32_t tick);
+
+    size_t numBirths(){					return births.size(); }
+    size_t numDeaths(){					return deaths.size(); }
+    const uint32_t* getBirths(){			return births.data(); }
+    const uint32_t* getDeaths(){			return deaths.data(); }
+};
+
+
+#endif
@@ -0,0 +1,88 @@
+/* Scenario.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCENARIO
+#define SCENARIO
+
+#include <stdint.h>
+#include <vector>
+#include "TiledFormat.h"
+
+/* Spatial distributions of the initial agents */
+enum ScenarioDistribution {
+    SCENARIO_UNIFORM = 0,
+    SCENARIO_CLUSTERED	// Gaussian clusters around the birth and death centers over a uniform background
+};
+
+/* Parameters of a generated initial state */
+struct ScenarioParameters {
+    uint64_t	agents;
+    int		width;
+    int		height;
+    int		tileSize;
+    uint32_t	seed;
+    int		distribution;
+    double	spread;		// standard deviation of the clusters, cells
+    double	background;	// fraction of the agents spread uniformly with SCENARIO_CLUSTERED
+    int		centerX[2];	// birth and death centers
+    int		centerY[2];
+};
+
+
+/* Generated initial state, partitioned by position. The space is split in
+   tiles as the tiled initial state file (TiledFormat.h); the number of agents
+   of a tile is its share of the expected population, rounded on the running
+   total so the tiles add up to the requested agents, and the agents of a tile
+   get consecutive keys in tile order. An agent position is drawn from the
+   counter based stream of its key, so any tile can be generated alone, by
+   any thread or process, and always gives the same agents. */
+class Scenario{
+
+private:
+    ScenarioParameters		p;
+    int				tilesX;
+    int				tilesY;
+    std::vector<uint64_t>	first;		// first key of every tile, number of agents at the end
+    std::vector<double>		tileWeight;	// mass of the background and the two clusters in every tile
+
+    static double normalCdf(double z);
+    double axisMass(int k, int axis, int from, int to) const;
+
+public:
+    Scenario(const ScenarioParameters& p);
+
+    static void fftValue(uint64_t i, uint32_t seed, double value[2]);
+
+    int tilesPerRow(){				return tilesX; }
+    int tileRows(){				return tilesY; }
+    int tiles(){				return tilesX * tilesY; }
+    const std::vector<uint64_t>& index(){	return first; }
+    uint64_t tileFirst(int t){			return first[t]; }
+    uint64_t tileCount(int t){			return first[t + 1] - first[t]; }
+
+    void header(TiledHeader& h);
+    void generate(int t, uint64_t from, uint64_t to, TiledRecord* out) const;
+    int tileOf(uint64_t key) const;
+};
+
+#endif
@@ -0,0 +1,77 @@
+/* ThreadPool.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef THREAD_POOL
+#define THREAD_POOL
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/* Fixed set of worker threads of a process, the calling thread takes part as thread 0 */
+class ThreadPool{
+
+public:
+    /* Job called as fn(thread, begin, end), kept as an object pointer plus a call thunk so no std::function is allocated */
+    typedef void (*JobCall)(const void* fn, int thread, size_t begin, size_t end);
+
+private:
+    int				nThreads;
+    std::vector<std::thread>	workers;
+    std::mutex			mutex;
+    std::condition_variable	wakeUp;
+    std::condition_variable	finished;
+    const void*			job;
+    JobCall			jobCall;
+    size_t			jobSize;
+    unsigned long		generation;
+    int				running;
+    bool			stopping;
+
+    void work(int thread);
+    void runChunk(int thread);
+    void run(size_t n, const void* fn, JobCall call);
+
+    template<typename F>
+    static void callJob(const void* fn, int thread, size_t begin, size_t end){
+        (*(const F*)fn)(thread, begin, end);
+    }
+
+public:
+    ThreadPool(int nThreads);
+    ~ThreadPool();
+
+    int size(){						return nThreads; }
+    static int current();
+
+    template<typename F>
+    void parallelFor(size_t n, const F& fn){		run(n, &fn, &callJob<F>); }
+};
+
+
+#endif
@@ -0,0 +1,43 @@
+/* TiledAgents.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TILED_AGENTS
+#define TILED_AGENTS
+
+#include <mpi.h>
+#include <string>
+#include <vector>
+#include "TiledFormat.h"
+
+
+/* Parallel load of a tiled initial state file (see TiledFormat.h). Every
+   process reads, with MPI-IO collective reads, the part of the tile index
+   and the rows of tiles covering its bounds, one block of the file per row
+   of tiles, and keeps the records inside the bounds. */
+class TiledAgents{
+
+public:
+    static void read(const std::string& file, MPI_Comm comm, int xmin, int ymin, int xmax, int ymax, std::vector<TiledRecord>& out, TiledHeader* header);
+};
+
+#endif
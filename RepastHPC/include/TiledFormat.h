@@ -0,0 +1,115 @@
+/* TiledFormat.h */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TILED_FORMAT
+#define TILED_FORMAT
+
+#include <stdint.h>
+#include <string.h>
+
+//Binary initial state, written by convert_init and read by TiledAgents
+#define TILED_MAGIC "ABMSTIL1"
+#define TILED_VERSION 1
+
+/* File header. It is followed by the tile index, tilesX*tilesY+1 uint64_t
+   with the first record of every tile (row major, tile (tx,ty) is entry
+   ty*tilesX+tx, the last entry is the number of records), and by the records
+   sorted by tile. Values are in the byte order of the machine that wrote it. */
+struct TiledHeader {
+    char	magic[8];
+    uint32_t	version;
+    int32_t	width;		// space the positions are in, [0,width) x [0,height)
+    int32_t	height;
+    int32_t	tileWidth;
+    int32_t	tileHeight;
+    int32_t	tilesX;
+    int32_t	tilesY;
+    uint32_t	pad;
+    uint64_t	records;
+};
+
+/* An agent of the initial state */
+struct TiledRecord {
+    uint64_t	key;		// line of the agent in the text file, its random stream key
+    uint32_t	id;		// id written by gen_file_init, unused by the model
+    int32_t	x;
+    int32_t	y;
+    int32_t	z;
+};
+
+/*
+ * Function: tiledIndexOffset
+ * --------------------
+ * Byte offset of the tile index in the file
+ *
+ * returns: offset
+ */
+inline uint64_t tiledIndexOffset(){
+	return sizeof(TiledHeader);
+}
+
+/*
+ * Function: tiledRecordsOffset
+ * --------------------
+ * Byte offset of the first record in the file
+ * 
+ * h: file header
+ *
+ * returns: offset
+ */
+inline uint64_t tiledRecordsOffset(const TiledHeader& h){
+	return sizeof(TiledHeader) + ((uint64_t)h.tilesX * h.tilesY + 1) * sizeof(uint64_t);
+}
+
+/*
+ * Function: tiledValid
+ * --------------------
+ * Check the magic and version of a header
+ * 
+ * h: file header
+ *
+ * returns: true if the header is from a file of this version
+ */
+inline bool tiledValid(const TiledHeader& h){
+	return memcmp(h.magic, TILED_MAGIC, sizeof(h.magic)) == 0 && h.version == TILED_VERSION &&
+	       h.tileWidth > 0 && h.tileHeight > 0 && h.tilesX > 0 && h.tilesY > 0;
+}
+
+/*
+ * Function: tiledClamp
+ * --------------------
+ * Tile column or row of a coordinate, positions outside the space go to the
+ * border tiles
+ * 
+ * v: coordinate
+ * tileSize: tile width or height
+ * tiles: tiles in the dimension
+ *
+ * returns: tile column or row
+ */
+inline int tiledClamp(int v, int tileSize, int tiles){
+	int t = (v < 0 ? 0 : v / tileSize);
+	return (t < tiles ? t : tiles - 1);
+}
+
+#endif
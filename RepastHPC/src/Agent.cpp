@@ -28,8 +28,14 @@
 #include <math.h>
 #include <cmath>
 #include <string.h>
+#include <algorithm>
 #include "Model.h"
 
+uint32_t RepastHPCAgent::seed = 0;
+uint32_t RepastHPCAgent::tick = 0;
+ModelParameters RepastHPCAgent::params;
+uint32_t RepastHPCAgent::epoch = 0;
+
 /*
  *    Class: RepastHPCAgent  
  * Function: RepastHPCAgent
@@ -37,12 +43,13 @@
  * RepastHPCAgent class constructor
  * 
  * id: agents identificator
+ * _key: random stream key, the same on any process layout
  * _N: FFT vector size
  * _in: pointer to FFT input vector
  *
  * returns: -
  */
-RepastHPCAgent::RepastHPCAgent(repast::AgentId id, int _N, fftw_complex *_in): id_(id), c(100), total(200), N(_N), in(_in){ 
+RepastHPCAgent::RepastHPCAgent(repast::AgentId id, uint64_t _key, int _N, fftw_complex *_in): id_(id), key(_key), c(100), total(200), cPayoff(0), totalPayoff(0), N(_N), in(_in), dirty(DIRTY_ALL), dirtyEpoch(epoch){ 
 	int i;
 	for (i=0; i<COM_BUFFER_SIZE; i++)
 		m[i]=0;
@@ -55,6 +62,7 @@ RepastHPCAgent::RepastHPCAgent(repast::AgentId id, int _N, fftw_complex *_in): i
  * RepastHPCAgent class constructor
  * 
  * id: agents identificator
+ * _key: random stream key, the same on any process layout
  * newC: initial value of payoff counter when agent cooperates 
  * newTotal: initial value of total payoff counter
  * newm: initial data to data buffer in agents communications
@@ -63,9 +71,11 @@ RepastHPCAgent::RepastHPCAgent(repast::AgentId id, int _N, fftw_complex *_in): i
  *
  * returns: -
  */
-RepastHPCAgent::RepastHPCAgent(repast::AgentId id, double newC, double newTotal, char newm[], int _N, fftw_complex *_in): id_(id), c(newC), total(newTotal), N(_N), in(_in){
-	for (int i=0; i<COM_BUFFER_SIZE; i++)
+RepastHPCAgent::RepastHPCAgent(repast::AgentId id, uint64_t _key, double newC, double newTotal, const char newm[], int _N, fftw_complex *_in): id_(id), key(_key), c(newC), total(newTotal), cPayoff(0), totalPayoff(0), N(_N), in(_in), dirty(DIRTY_ALL), dirtyEpoch(epoch){
+	for (int i=0; i<params.comBufferSize; i++)
 		m[i]=newm[i];
+	for (int i=params.comBufferSize; i<COM_BUFFER_SIZE; i++)
+		m[i]=0;
 }
 
 /*
@@ -92,15 +102,58 @@ RepastHPCAgent::~RepastHPCAgent(){
  * returns: -
  */
 void RepastHPCAgent::getm(char newm[]){
- 	for (int i=0; i<COM_BUFFER_SIZE; i++)
+ 	for (int i=0; i<params.comBufferSize; i++)
 		newm[i]=m[i];
 }
 
+/*
+ *    Class: RepastHPCAgent  
+ * Function: getPackage
+ * --------------------
+ * Fill a package with the agent state, m copied once straight into it
+ * 
+ * package: package to fill
+ *
+ * returns: -
+ */
+void RepastHPCAgent::getPackage(RepastHPCAgentPackage& package){
+	package.id          = id_.id();
+	package.rank        = id_.startingRank();
+	package.type        = id_.agentType();
+	package.currentRank = id_.currentRank();
+	package.key         = key;
+	package.c           = c;
+	package.total       = total;
+	package.N           = N;
+	package.mlen        = params.comBufferSize;
+	memcpy(package.m, m, package.mlen);
+}
+
+/*
+ *    Class: RepastHPCAgent  
+ * Function: getDelta
+ * --------------------
+ * Fill a delta with the fields changed since the last ghost state exchange
+ * 
+ * delta: delta to fill
+ *
+ * returns: -
+ */
+void RepastHPCAgent::getDelta(RepastHPCAgentDelta& delta){
+	delta.id          = id_.id();
+	delta.rank        = id_.startingRank();
+	delta.type        = id_.agentType();
+	delta.fields      = dirtyFields();
+	delta.currentRank = id_.currentRank();
+	delta.c           = c;
+	delta.total       = total;
+}
+
 /*
  *    Class: RepastHPCAgent  
  * Function: set
  * --------------------
- * Set rank, newC and newTotal
+ * Set rank, newC and newTotal, a rank change is marked dirty
  * 
  * currentRank: process rank
  * newC: value of payoff counter when agent cooperates 
@@ -110,11 +163,29 @@ void RepastHPCAgent::getm(char newm[]){
  * returns: -
  */
 void RepastHPCAgent::set(int currentRank, double newC, double newTotal){
+	// A ghost promoted in place by a migration has a new owner the other holders must learn
+	if (currentRank != id_.currentRank()) markDirty(DIRTY_RANK);
 	id_.currentRank(currentRank);
 	c     = newC;
 	total = newTotal;
 }
 
+/*
+ *    Class: RepastHPCAgent  
+ * Function: set
+ * --------------------
+ * Apply the fields of a delta
+ * 
+ * delta: fields changed in the agent owner process
+ *
+ * returns: -
+ */
+void RepastHPCAgent::set(const RepastHPCAgentDelta& delta){
+	if (delta.fields & DIRTY_RANK)  id_.currentRank(delta.currentRank);
+	if (delta.fields & DIRTY_C)     c     = delta.c;
+	if (delta.fields & DIRTY_TOTAL) total = delta.total;
+}
+
 /*
  *    Class: RepastHPCAgent  
  * Function: setm
@@ -126,38 +197,68 @@ void RepastHPCAgent::set(int currentRank, double newC, double newTotal){
  * returns: -
  */
 void RepastHPCAgent::setm(char newm[]){
- 	for (int i=0; i<COM_BUFFER_SIZE; i++)
+ 	for (int i=0; i<params.comBufferSize; i++)
 		m[i]=newm[i];
 }
 
+/*
+ *    Class: RepastHPCAgent  
+ * Function: setStep
+ * --------------------
+ * Set the seed and the tick of the random numbers drawn by every agent
+ * 
+ * _seed: run seed
+ * _tick: current tick
+ *
+ * returns: -
+ */
+void RepastHPCAgent::setStep(uint32_t _seed, uint32_t _tick){
+	seed = _seed;
+	tick = _tick;
+}
+
+/*
+ *    Class: RepastHPCAgent  
+ * Function: birthKey
+ * --------------------
+ * Get the key of the agent born from this one in the current tick. Derived
+ * keys have the high bit set so they never clash with initial keys (the
+ * agent index in the initial agents file)
+ * 
+ * -: -
+ *
+ * returns: key of the new agent
+ */
+uint64_t RepastHPCAgent::birthKey(){
+	return CounterRNG::bits(key, seed, tick, STREAM_BIRTH, 0) | ((uint64_t)1 << 63);
+}
+
 /*
  *    Class: RepastHPCAgent  
  * Function: cooperate
  * --------------------
  * Get if agent wants to cooperate
  * 
- * -: -
+ * opponentKey: key of the agent played against, so the draw does not depend on the order of play
  *
  * returns: true: agent wants to cooperate
  */
-bool RepastHPCAgent::cooperate(){
-	return repast::Random::instance()->nextDouble() < c/total;
+bool RepastHPCAgent::cooperate(uint64_t opponentKey){
+	return nextDouble(STREAM_COOPERATE, CounterRNG::digest(opponentKey)) < c/total;
 }
 
 /*
  *    Class: RepastHPCAgent  
  * Function: frand
  * --------------------
- * Get a random number between 0 and RAND_MAX
+ * Get a random number between 0 and 1
  * 
- * -: -
+ * draw: index of the draw in the current tick
  *
  * returns: random number
  */
-double RepastHPCAgent::frand(void) {
-	double value;
-	value = ((double)rand()/(RAND_MAX));
-	return value;
+double RepastHPCAgent::frand(uint32_t draw) {
+	return nextDouble(STREAM_FRAND, draw);
 }
 
 /*
@@ -189,19 +290,30 @@ bool RepastHPCAgent::isIntoCircle(int x, int y, int xCircle, int yCircle, int rC
  * --------------------
  * compute a FFT of a FFT_VECTOR_SIZE vector size
  * 
- * -: No parameters
+ * plans: process FFT plan cache, owns the plan and the output buffer
+ * slot: output buffer slot of the calling thread
  *
  * returns: 
  */
-void RepastHPCAgent::compute() {
-	fftw_plan p;
-	double fft_out_sum = 0;
-        	        							
-	reinterpret_cast<fftw_complex*>(out);
-        out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+void RepastHPCAgent::compute(FFTPlanCache* plans, int slot) {
+	fftw_complex *out = plans->buffer(N, 1, slot);
 
-	p = fftw_plan_dft_1d(N, in, out, FFTW_FORWARD, FFTW_ESTIMATE);
-	fftw_execute(p); 
+	fftw_execute_dft(plans->plan(N), in, out);
+	reduceFFT(out);
+}
+
+/*
+ *    Class: RepastHPCAgent  
+ * Function: reduceFFT 
+ * --------------------
+ * consume the FFT of the agent input vector, computed by compute() or by a batch
+ * 
+ * out: FFT output vector of N elements
+ *
+ * returns: 
+ */
+void RepastHPCAgent::reduceFFT(fftw_complex *out) {
+	double fft_out_sum = 0;
 
         for(int i=0; i < N ; i++) {
                 fft_out_sum += out[i][0];
@@ -209,9 +321,6 @@ void RepastHPCAgent::compute() {
         }
 
 	//cout << "fft_out_sum " << fft_out_sum << endl;
-
-	fftw_destroy_plan(p);	
-	fftw_free(out);
 }
 
 
@@ -219,28 +328,53 @@ void RepastHPCAgent::compute() {
  *    Class: RepastHPCAgent  
  * Function: play 
  * --------------------
- * play prisoner’s dilemma with all agents located until RADIUS distance
+ * play prisoner’s dilemma with all agents located until RADIUS distance. The
+ * payoff is kept apart until commitPlay(), so every agent plays against the
+ * c/total values of the previous tick whatever the order (or the thread) in
+ * which agents play
  *
  * context-: Repast context
  * space: Repast space
+ * scratch: storage of the calling thread
  *
  * returns: 
  */
 void RepastHPCAgent::play(repast::SharedContext<RepastHPCAgent>* context,
-                              repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space){
-	std::vector<RepastHPCAgent*> agentsToPlay;
-	int i=0;
+                              repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, AgentScratch& scratch){
+	scratch.loc.clear();	// getLocation inserts the coordinates, reused storage must start empty
+	space->getLocation(id_, scratch.loc);
+	play(context, space, scratch.loc[0], scratch.loc[1], scratch);
+}
+
+/*
+ *    Class: RepastHPCAgent  
+ * Function: play 
+ * --------------------
+ * play prisoner’s dilemma, agent location already known
+ *
+ * context-: Repast context
+ * space: Repast space
+ * x,y: agent location
+ * scratch: storage of the calling thread
+ *
+ * returns: 
+ */
+void RepastHPCAgent::play(repast::SharedContext<RepastHPCAgent>* context,
+                              repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, int x, int y, AgentScratch& scratch){
+	std::vector<RepastHPCAgent*>& agentsToPlay   = scratch.candidates;
+	std::vector<RepastHPCAgent*>& agentsInCircle = scratch.inCircle;
     
-	std::vector<int> agentLoc;
-       	std::vector<int> agentLocToPlay;
+       	std::vector<int>& agentLocToPlay = scratch.loc;
 
-	space->getLocation(id_, agentLoc);
-	repast::Point<int> center(agentLoc);
+	agentsToPlay.clear();
+	agentsInCircle.clear();
+
+	repast::Point<int> center(x, y);
 	repast::Moore2DGridQuery<RepastHPCAgent> moore2DQuery(space);
-	moore2DQuery.query(center,  RADIOUS, true, agentsToPlay);
+	moore2DQuery.query(center,  params.radius, true, agentsToPlay);
     
-	double cPayoff     = 0;
-	double totalPayoff = 0;
+	cPayoff     = 0;
+	totalPayoff = 0;
 	std::vector<RepastHPCAgent*>::iterator agentToPlay = agentsToPlay.begin();
 
 	while(agentToPlay != agentsToPlay.end()){
@@ -249,29 +383,178 @@ void RepastHPCAgent::play(repast::SharedContext<RepastHPCAgent>* context,
 			continue; // Do not play with himself
 		}
 
+		agentLocToPlay.clear();
         	space->getLocation(((*agentToPlay)->getId()), agentLocToPlay);
-		if (isIntoCircle(agentLoc[0], agentLoc[1], agentLocToPlay[0], agentLocToPlay[1], RADIOUS)){
-
-			bool iCooperated = cooperate();                          // Do I cooperate?
-			bool otherCooperated = (*agentToPlay)->cooperate();	// Does other agent cooperate? 
+		if (isIntoCircle(x, y, agentLocToPlay[0], agentLocToPlay[1], params.radius))
+			agentsInCircle.push_back(*agentToPlay);
+			
+		agentToPlay++;
+    	}
 
-			double payoff = (iCooperated ?
-				( otherCooperated ?  7 : 1) :     // If I cooperated, did my opponent?
-				( otherCooperated ? 10 : 3));     // If I didn't cooperate, did my opponent?
-			if(iCooperated) cPayoff += payoff;
-			totalPayoff             += payoff;
-		
-			i++;
-			if (i >= MAX_AGENTS_TO_PLAY) break;	//Control max number agents to play with
+	//Control max number agents to play with, keeping the ones with the lowest per pair draw (ties by key) so the choice
+	//does not depend on the query order and every agent of a dense area does not end playing the same opponents
+	if (agentsInCircle.size() > (size_t)params.maxAgentsToPlay){
+		std::nth_element(agentsInCircle.begin(), agentsInCircle.begin() + params.maxAgentsToPlay, agentsInCircle.end(),
+			[this](RepastHPCAgent* a, RepastHPCAgent* b){
+				uint64_t ra = selectRank(a->getKey()), rb = selectRank(b->getKey());
+				return ra < rb || (ra == rb && a->getKey() < b->getKey());
+			});
+		agentsInCircle.resize(params.maxAgentsToPlay);
+	}
+
+	for (size_t i=0; i<agentsInCircle.size(); i++){
+		bool iCooperated = cooperate(agentsInCircle[i]->getKey());     // Do I cooperate?
+		bool otherCooperated = agentsInCircle[i]->cooperate(key);	// Does other agent cooperate? 
+
+		double payoff = (iCooperated ?
+			( otherCooperated ?  7 : 1) :     // If I cooperated, did my opponent?
+			( otherCooperated ? 10 : 3));     // If I didn't cooperate, did my opponent?
+		if(iCooperated) cPayoff += payoff;
+		totalPayoff             += payoff;
+	}
+}
 
+/*
+ *    Class: RepastHPCAgent  
+ * Function: playCells 
+ * --------------------
+ * play prisoner’s dilemma with the agents found by the cell grid, same
+ * opponents as the Repast query: the max agents to play lowest selection
+ * draws in the circle, kept sorted in a fixed array while the cells are scanned. RADIUS
+ * and MAX_PLAY fold into the loop, 0 takes the value of the run parameters.
+ *
+ * cells: cell grid of the process, updated this tick
+ * x,y: agent location
+ * scratch: storage of the calling thread, used when MAX_PLAY is 0
+ *
+ * returns: 
+ */
+template<int RADIUS, int MAX_PLAY>
+void RepastHPCAgent::playCells(CellGrid* cells, int x, int y, AgentScratch& scratch){
+	const int maxPlay = (MAX_PLAY > 0 ? MAX_PLAY : params.maxAgentsToPlay);
+	RepastHPCAgent* fixedAgents[MAX_PLAY > 0 ? MAX_PLAY : 1];
+	uint64_t fixedKeys[MAX_PLAY > 0 ? MAX_PLAY : 1];
+	uint64_t fixedRanks[MAX_PLAY > 0 ? MAX_PLAY : 1];
+	RepastHPCAgent** agentsInCircle = fixedAgents;
+	uint64_t* keys = fixedKeys;
+	uint64_t* ranks = fixedRanks;
+	int found = 0;
+
+	if (MAX_PLAY == 0){
+		scratch.inCircle.resize(maxPlay + 1);
+		scratch.keys.resize(maxPlay + 1);
+		scratch.ranks.resize(maxPlay + 1);
+		agentsInCircle = scratch.inCircle.data();
+		keys = scratch.keys.data();
+		ranks = scratch.ranks.data();
+	}
+
+	cells->forEachInRadius<RADIUS>(x, y, [&](const CellEntry& e){
+		if (e.agent == this || maxPlay == 0) return; // Do not play with himself
+		uint64_t rank = selectRank(e.key);
+		if (found == maxPlay && (rank > ranks[found-1] || (rank == ranks[found-1] && e.key >= keys[found-1]))) return;
+
+		int i = (found < maxPlay) ? found++ : found - 1;
+		for (; i > 0 && (ranks[i-1] > rank || (ranks[i-1] == rank && keys[i-1] > e.key)); i--){
+			ranks[i]          = ranks[i-1];
+			keys[i]           = keys[i-1];
+			agentsInCircle[i] = agentsInCircle[i-1];
 		}
-			
-		agentToPlay++;
+		ranks[i]          = rank;
+		keys[i]           = e.key;
+		agentsInCircle[i] = e.agent;
+	});
+
+	cPayoff     = 0;
+	totalPayoff = 0;
+	for (int i=0; i<found; i++){
+		bool iCooperated = cooperate(keys[i]);                 // Do I cooperate?
+		bool otherCooperated = agentsInCircle[i]->cooperate(key);	// Does other agent cooperate? 
+
+		double payoff = (iCooperated ?
+			( otherCooperated ?  7 : 1) :     // If I cooperated, did my opponent?
+			( otherCooperated ? 10 : 3));     // If I didn't cooperate, did my opponent?
+		if(iCooperated) cPayoff += payoff;
+		totalPayoff             += payoff;
+	}
+}
 
-    	}
+/*
+ *    Class: RepastHPCAgent  
+ * Function: playKernel 
+ * --------------------
+ * choose the playCells specialization of a (radius, max agents to play) pair
+ *
+ * radius: interaction radius
+ * maxAgentsToPlay: max number of agents to play with
+ * specialized: set to false when no specialization matches, may be null
+ *
+ * returns: specialized playCells, or playCells<0, 0> that reads the run parameters
+ */
+RepastHPCAgent::PlayKernel RepastHPCAgent::playKernel(int radius, int maxAgentsToPlay, bool* specialized){
+	static const struct {
+		int		radius;
+		int		maxAgentsToPlay;
+		PlayKernel	kernel;
+	} kernels[] = {
+		{  5,  5, &RepastHPCAgent::playCells< 5,  5> },
+		{  5, 10, &RepastHPCAgent::playCells< 5, 10> },
+		{  5, 20, &RepastHPCAgent::playCells< 5, 20> },
+		{ 10,  5, &RepastHPCAgent::playCells<10,  5> },
+		{ 10, 10, &RepastHPCAgent::playCells<10, 10> },
+		{ 10, 20, &RepastHPCAgent::playCells<10, 20> },
+		{ 20,  5, &RepastHPCAgent::playCells<20,  5> },
+		{ 20, 10, &RepastHPCAgent::playCells<20, 10> },
+		{ 20, 20, &RepastHPCAgent::playCells<20, 20> },
+	};
+
+	for (size_t k=0; k<sizeof(kernels)/sizeof(kernels[0]); k++){
+		if (kernels[k].radius == radius && kernels[k].maxAgentsToPlay == maxAgentsToPlay){
+			if (specialized) *specialized = true;
+			return kernels[k].kernel;
+		}
+	}
+	if (specialized) *specialized = false;
+	return &RepastHPCAgent::playCells<0, 0>;
+}
 
+/*
+ *    Class: RepastHPCAgent  
+ * Function: commitPlay 
+ * --------------------
+ * apply the payoff of the last play
+ *
+ * -: -
+ *
+ * returns: 
+ */
+void RepastHPCAgent::commitPlay(){
+	if (cPayoff != 0)     markDirty(DIRTY_C);
+	if (totalPayoff != 0) markDirty(DIRTY_TOTAL);
 	c      += cPayoff;
 	total  += totalPayoff;
+	cPayoff     = 0;
+	totalPayoff = 0;
+}
+
+/*
+ *    Class: RepastHPCAgent  
+ * Function: nextLocation 
+ * --------------------
+ * choose the next agent location, one random step in each axis
+ *
+ * space: Repast space
+ * agentNewLoc: next location
+ *
+ * returns: 
+ */
+void RepastHPCAgent::nextLocation(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, std::vector<int>& agentNewLoc){
+
+	agentNewLoc.clear();
+	space->getLocation(id_, agentNewLoc);
+
+	agentNewLoc[0] += moveStep(key, 0);
+	agentNewLoc[1] += moveStep(key, 1);
 }
 
 /*
@@ -286,17 +569,37 @@ void RepastHPCAgent::play(repast::SharedContext<RepastHPCAgent>* context,
  */
 void RepastHPCAgent::move(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space){
 
-	std::vector<int> agentLoc;
-	space->getLocation(id_, agentLoc);
 	std::vector<int> agentNewLoc;
+	nextLocation(space, agentNewLoc);
+	space->moveTo(id_,agentNewLoc);
+}
 
-	int nextx = agentLoc[0] + (repast::Random::instance()->nextDouble() < 0.5 ? -1 : 1);
-	int nexty = agentLoc[1] + (repast::Random::instance()->nextDouble() < 0.5 ? -1 : 1);
-
-	agentNewLoc.push_back(nextx);
-	agentNewLoc.push_back(nexty);
+/*
+ *    Class: RepastHPCAgent  
+ * Function: deathRateFactor 
+ * --------------------
+ * death probability at a location, death rate at the death center going down lineally until borders of space
+ *
+ * x,y: location
+ *
+ * returns: death probability
+ */
+float RepastHPCAgent::deathRateFactor(int x, int y){
+	return params.deathRate * (1 - fmin(1 , sqrt( pow(abs(x-params.centerDeathX),2) + pow(abs(y-params.centerDeathY),2) )/((params.height+params.width)/2)));
+}
 
-	space->moveTo(id_,agentNewLoc);
+/*
+ *    Class: RepastHPCAgent  
+ * Function: birthRateFactor 
+ * --------------------
+ * birth probability at a location, birth rate at the birth center going down lineally until borders of space
+ *
+ * x,y: location
+ *
+ * returns: birth probability
+ */
+float RepastHPCAgent::birthRateFactor(int x, int y){
+	return params.birthRate * (1 - fmin(1 , sqrt( pow(abs(x-params.centerBirthX),2) + pow(abs(y-params.centerBirthY),2) )/((params.height+params.width)/2)));
 }
 
 /*
@@ -306,17 +609,15 @@ void RepastHPCAgent::move(repast::SharedDiscreteSpace<RepastHPCAgent, repast::Wr
  * compute death algorithm
  *
  * space: Repast space
+ * agentLoc: location storage of the calling thread
  *
  * returns: true: death
  */
-bool RepastHPCAgent::die(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space){
-	std::vector<int> agentLoc;
+bool RepastHPCAgent::die(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, std::vector<int>& agentLoc){
+	agentLoc.clear();
 	space->getLocation(id_, agentLoc);
-	int x = agentLoc[0];
-	int y = agentLoc[1];
-	float death_rate_factor = DEATH_RATE * (1 - fmin(1 , sqrt( pow(abs(x-CENTER_DEATH_X),2) + pow(abs(y-CENTER_DEATH_Y),2) )/((HEIGHT+WIDTH)/2)));
 
-	return (repast::Random::instance()->nextDouble() < death_rate_factor ? true : false);
+	return dies(key, agentLoc[0], agentLoc[1]);
 }
 
 /*
@@ -326,17 +627,15 @@ bool RepastHPCAgent::die(repast::SharedDiscreteSpace<RepastHPCAgent, repast::Wra
  * compute birth algorithm
  *
  * space: Repast space
+ * agentLoc: location storage of the calling thread
  *
  * returns: true: birth
  */
-bool RepastHPCAgent::reproduction(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space){
-	std::vector<int> agentLoc;
+bool RepastHPCAgent::reproduction(repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space, std::vector<int>& agentLoc){
+	agentLoc.clear();
         space->getLocation(id_, agentLoc);
-        int x = agentLoc[0];
-        int y = agentLoc[1];
-	float birth_rate_factor = BIRTH_RATE * (1 - fmin(1 , sqrt( pow(abs(x-CENTER_BIRTH_X),2) + pow(abs(y-CENTER_BIRTH_Y),2) )/((HEIGHT+WIDTH)/2)));
 
-	return (repast::Random::instance()->nextDouble() < birth_rate_factor ? true : false);
+	return reproduces(key, agentLoc[0], agentLoc[1]);
 }
 
 /* Serializable Agent Package Data */
@@ -365,15 +664,55 @@ RepastHPCAgentPackage::RepastHPCAgentPackage(){
  * _rank : process rank 
  * _type : type of agent
  * _currentRank : current process rank 
+ * _key: agent random stream key
  * _c: value of payoff counter when agent cooperates 
  * _total: value of total payoff counter
- * _m: communication message
+ * _m: communication message, model.com.buffer.size bytes
  * _N: FFT vector file data size
  *
  * returns: -
  */
-RepastHPCAgentPackage::RepastHPCAgentPackage(int _id, int _rank, int _type, int _currentRank, double _c, double _total, char _m[], int _N):
-id(_id), rank(_rank), type(_type), currentRank(_currentRank), c(_c), total(_total), N(_N){ 
-	for (int i=0; i<COM_BUFFER_SIZE; i++)
-		m[i]=_m[i];
+RepastHPCAgentPackage::RepastHPCAgentPackage(int _id, int _rank, int _type, int _currentRank, uint64_t _key, double _c, double _total, char _m[], int _N){ 
+	id          = _id;
+	rank        = _rank;
+	type        = _type;
+	currentRank = _currentRank;
+	key         = _key;
+	c           = _c;
+	total       = _total;
+	N           = _N;
+	mlen        = RepastHPCAgent::getParameters().comBufferSize;
+	memcpy(m, _m, mlen);
+}
+
+/*
+ *    Class: RepastHPCAgentPackage 
+ * Function: pack
+ * --------------------
+ * Write the package in the flat wire format
+ *
+ * buffer: destination, at least wireSize() bytes
+ *
+ * returns: end of the written bytes
+ */
+char* RepastHPCAgentPackage::pack(char* buffer) const {
+	memcpy(buffer, static_cast<const RepastHPCAgentPackageHeader*>(this), sizeof(RepastHPCAgentPackageHeader));
+	memcpy(buffer + sizeof(RepastHPCAgentPackageHeader), m, mlen);
+	return buffer + wireSize();
+}
+
+/*
+ *    Class: RepastHPCAgentPackage 
+ * Function: unpack
+ * --------------------
+ * Read a package written by pack
+ *
+ * buffer: source
+ *
+ * returns: end of the read bytes
+ */
+const char* RepastHPCAgentPackage::unpack(const char* buffer){
+	memcpy(static_cast<RepastHPCAgentPackageHeader*>(this), buffer, sizeof(RepastHPCAgentPackageHeader));
+	memcpy(m, buffer + sizeof(RepastHPCAgentPackageHeader), mlen);
+	return buffer + wireSize();
 }
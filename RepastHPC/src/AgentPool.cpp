@@ -0,0 +1,173 @@
+/* AgentPool.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <cstddef>
+#include <iostream>
+#include <new>
+#include <functional>
+#include <boost/mpi/collectives.hpp>
+#include "AgentPool.h"
+
+/*
+ *    Class: AgentPool  
+ * Function: AgentPool
+ * --------------------
+ * AgentPool constructor
+ * 
+ * _name: pool name used in the report
+ * objectBytes: size of the objects
+ *
+ * returns: -
+ */
+AgentPool::AgentPool(std::string _name, size_t objectBytes): name(_name), freeList(nullptr), inUse(0), highWater(0), roleInUse(0), roleHighWater(0){
+	const size_t align = 64;
+
+	slotBytes    = (objectBytes < sizeof(void*) ? sizeof(void*) : objectBytes);
+	slotBytes    = (slotBytes + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+	firstSlot    = (sizeof(Slab) + align - 1) / align * align;
+	slotsPerSlab = (AGENT_POOL_SLAB_BYTES - firstSlot) / slotBytes;
+}
+
+/*
+ *    Class: AgentPool  
+ * Function: ~AgentPool
+ * --------------------
+ * AgentPool destructor, gives the slabs back. Objects of the pool must have
+ * been deleted before.
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+AgentPool::~AgentPool(){
+	for (size_t i=0; i<slabs.size(); i++)
+		::free(slabs[i]);
+}
+
+/*
+ *    Class: AgentPool  
+ * Function: grow
+ * --------------------
+ * Take a new slab and put its slots in the free list
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void AgentPool::grow(){
+	void *memory = nullptr;
+
+	if (posix_memalign(&memory, AGENT_POOL_SLAB_BYTES, AGENT_POOL_SLAB_BYTES) != 0) throw std::bad_alloc();
+	slabs.push_back(memory);
+	((Slab*)memory)->owner = this;
+
+	// Lowest address first out
+	char *slot = (char*)memory + firstSlot + (slotsPerSlab - 1) * slotBytes;
+	for (size_t i=0; i<slotsPerSlab; i++, slot -= slotBytes){
+		*(void**)slot = freeList;
+		freeList = slot;
+	}
+}
+
+/*
+ *    Class: AgentPool  
+ * Function: allocate
+ * --------------------
+ * Get a slot for an object
+ * 
+ * -: -
+ *
+ * returns: uninitialized slot
+ */
+void* AgentPool::allocate(){
+	if (freeList == nullptr) grow();
+
+	void *p = freeList;
+	freeList = *(void**)p;
+	if (++inUse > highWater) highWater = inUse;
+	return p;
+}
+
+/*
+ *    Class: AgentPool  
+ * Function: release
+ * --------------------
+ * Give back the slot of a destroyed object
+ * 
+ * p: slot
+ *
+ * returns: -
+ */
+void AgentPool::release(void* p){
+	*(void**)p = freeList;
+	freeList = p;
+	inUse--;
+}
+
+/*
+ *    Class: AgentPool  
+ * Function: free
+ * --------------------
+ * Give back a slot to the pool owning it, found in the header of its slab
+ * 
+ * p: slot
+ *
+ * returns: -
+ */
+void AgentPool::free(void* p){
+	if (p == nullptr) return;
+
+	Slab *slab = (Slab*)((uintptr_t)p & ~(uintptr_t)(AGENT_POOL_SLAB_BYTES - 1));
+	slab->owner->release(p);
+}
+
+/*
+ *    Class: AgentPool  
+ * Function: report
+ * --------------------
+ * Reduce the pool occupancy over all processes, rank 0 prints the total and
+ * max per process agents of the role of the pool and their high water mark,
+ * then the objects created from the pool in use, their high water mark and
+ * the capacity
+ * 
+ * comm: mpi communicator
+ *
+ * returns: -
+ */
+void AgentPool::report(boost::mpi::communicator* comm){
+	unsigned long long local[5] = { roleInUse, roleHighWater, inUse, highWater, capacity() };
+	unsigned long long maxs[5], sums[5];
+
+	boost::mpi::reduce(*comm, local, 5, maxs, boost::mpi::maximum<unsigned long long>(), 0);
+	boost::mpi::reduce(*comm, local, 5, sums, std::plus<unsigned long long>(), 0);
+
+	if (comm->rank() != 0) return;
+
+	std::cout << "Agent pool " << name << " (" << name << " agents): in use " << sums[0] << " max " << maxs[0]
+	          << " high water " << sums[1] << " max " << maxs[1] << std::endl;
+	std::cout << "Agent pool " << name << " (objects created here): in use " << sums[2] << " max " << maxs[2]
+	          << " high water " << sums[3] << " max " << maxs[3]
+	          << " capacity " << sums[4] << " max " << maxs[4]
+	          << " (" << slotBytes << " bytes per object)" << std::endl;
+}
@@ -0,0 +1,170 @@
+/* AgentTable.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AgentTable.h"
+#include "Agent.h"
+
+/*
+ *    Class: AgentTable  
+ * Function: AgentTable
+ * --------------------
+ * AgentTable constructor
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+AgentTable::AgentTable(){
+}
+
+/*
+ *    Class: AgentTable  
+ * Function: valid
+ * --------------------
+ * Check if a handle refers to a live entry
+ * 
+ * handle: entry handle
+ *
+ * returns: true if the entry was not removed
+ */
+bool AgentTable::valid(AgentHandle handle){
+	return handle.slot < slotGeneration.size() && slotGeneration[handle.slot] == handle.generation && slotRow[handle.slot] != UINT32_MAX;
+}
+
+/*
+ *    Class: AgentTable  
+ * Function: add
+ * --------------------
+ * Append a local agent and give it a handle
+ * 
+ * a: agent
+ * ax,ay: agent location
+ *
+ * returns: handle of the new entry, also stored in the agent
+ */
+AgentHandle AgentTable::add(RepastHPCAgent* a, int ax, int ay){
+	AgentHandle handle;
+
+	if (freeSlots.empty()){
+		handle.slot = slotRow.size();
+		slotRow.push_back(0);
+		slotGeneration.push_back(0);
+	} else {
+		handle.slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	handle.generation = slotGeneration[handle.slot];
+	slotRow[handle.slot] = agent.size();
+
+	agent.push_back(a);
+	id.push_back(a->getId());
+	key.push_back(a->getKey());
+	x.push_back(ax);
+	y.push_back(ay);
+	rowSlot.push_back(handle.slot);
+	seen.push_back(0);
+
+	a->setHandle(handle);
+	return handle;
+}
+
+/*
+ *    Class: AgentTable  
+ * Function: remove
+ * --------------------
+ * Remove a row moving the last row into it, the handle of the removed entry
+ * becomes invalid. Does not touch the agent object, which may already be
+ * deleted by Repast.
+ * 
+ * r: row
+ *
+ * returns: -
+ */
+void AgentTable::remove(size_t r){
+	size_t last = agent.size() - 1;
+	uint32_t slot = rowSlot[r];
+
+	slotRow[slot] = UINT32_MAX;
+	slotGeneration[slot]++;
+	freeSlots.push_back(slot);
+
+	if (r != last){
+		agent[r]   = agent[last];
+		id[r]      = id[last];
+		key[r]     = key[last];
+		x[r]       = x[last];
+		y[r]       = y[last];
+		rowSlot[r] = rowSlot[last];
+		seen[r]    = seen[last];
+		slotRow[rowSlot[r]] = r;
+	}
+
+	agent.pop_back();
+	id.pop_back();
+	key.pop_back();
+	x.pop_back();
+	y.pop_back();
+	rowSlot.pop_back();
+	seen.pop_back();
+}
+
+/*
+ *    Class: AgentTable  
+ * Function: sync
+ * --------------------
+ * Bring the table in line with the local agents of the context after a
+ * Repast synchronization: agents that arrived (migrated in, or ghosts that
+ * became local) are added with their location in the space, rows whose agent
+ * left the process are removed.
+ * 
+ * context: Repast context
+ * space: Repast space
+ *
+ * returns: -
+ */
+void AgentTable::sync(repast::SharedContext<RepastHPCAgent>* context,
+                      repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space){
+	size_t known = agent.size();
+
+	for (size_t r=0; r<known; r++)
+		seen[r] = 0;
+
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iter    = context->localBegin();
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iterEnd = context->localEnd();
+	while (iter != iterEnd){
+		RepastHPCAgent* a = *iter;
+		AgentHandle handle = a->getHandle();
+		if (valid(handle) && agent[row(handle)] == a){
+			seen[row(handle)] = 1;
+		} else {
+			agentLoc.clear();
+			space->getLocation(a->getId(), agentLoc);
+			add(a, agentLoc[0], agentLoc[1]);
+			seen.back() = 1;
+		}
+		iter++;
+	}
+
+	for (size_t r=agent.size(); r-- > 0; )
+		if (!seen[r]) remove(r);
+}
@@ -0,0 +1,139 @@
+/* AllocCounter.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include "AllocCounter.h"
+
+static std::atomic<uint64_t> allocationCount(0);
+static std::atomic<uint64_t> allocationBytes(0);
+
+/*
+ *    Class: AllocCounter  
+ * Function: enabled
+ * --------------------
+ * Check if allocations are being counted
+ * 
+ * -: -
+ *
+ * returns: true if compiled with ALLOC_COUNTING
+ */
+bool AllocCounter::enabled(){
+#ifdef ALLOC_COUNTING
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ *    Class: AllocCounter  
+ * Function: allocations
+ * --------------------
+ * Get the number of heap allocations of the process so far, all threads
+ * 
+ * -: -
+ *
+ * returns: number of allocations
+ */
+uint64_t AllocCounter::allocations(){
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+/*
+ *    Class: AllocCounter  
+ * Function: bytes
+ * --------------------
+ * Get the bytes requested by the heap allocations of the process so far
+ * 
+ * -: -
+ *
+ * returns: bytes allocated
+ */
+uint64_t AllocCounter::bytes(){
+	return allocationBytes.load(std::memory_order_relaxed);
+}
+
+#ifdef ALLOC_COUNTING
+
+/*
+ * Function: countedAlloc
+ * --------------------
+ * malloc counting the allocation
+ * 
+ * size: bytes requested
+ *
+ * returns: allocated memory, NULL on failure
+ */
+static void* countedAlloc(size_t size){
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size){
+	void *p = countedAlloc(size);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size){
+	void *p = countedAlloc(size);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept{
+	return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept{
+	free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept{
+	free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept{
+	free(p);
+}
+
+#endif
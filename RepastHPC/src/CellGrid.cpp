@@ -0,0 +1,168 @@
+/* CellGrid.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CellGrid.h"
+#include "Agent.h"
+
+/*
+ *    Class: CellGrid  
+ * Function: CellGrid
+ * --------------------
+ * CellGrid constructor, builds the disk stencil: the cell offsets holding at
+ * least one point at distance _radius or less of some point of the center cell
+ * 
+ * _radius: interaction radius
+ * _cellSize: side of a cell
+ *
+ * returns: -
+ */
+CellGrid::CellGrid(int _radius, int _cellSize): radius(_radius), cellSize(_cellSize < 1 ? 1 : _cellSize),
+		originX(0), originY(0), cellsX(0), cellsY(0), stamp(0){
+	int reach = (radius + cellSize - 1) / cellSize;
+
+	for (int dy=-reach; dy<=reach; dy++){
+		for (int dx=-reach; dx<=reach; dx++){
+			// Closest points of two cells dx, dy cells apart
+			int gx = dx == 0 ? 0 : (dx < 0 ? -dx : dx) * cellSize - (cellSize - 1);
+			int gy = dy == 0 ? 0 : (dy < 0 ? -dy : dy) * cellSize - (cellSize - 1);
+			if (gx*gx + gy*gy <= radius*radius){
+				stencilX.push_back(dx);
+				stencilY.push_back(dy);
+			}
+		}
+	}
+}
+
+/*
+ *    Class: CellGrid  
+ * Function: setBounds
+ * --------------------
+ * Lay the cells over the local bounds widened by the radius, dropping every
+ * entry. Called when the space is created and whenever the bounds change.
+ * 
+ * bounds: local bounds of the process
+ *
+ * returns: -
+ */
+void CellGrid::setBounds(const repast::GridDimensions& bounds){
+	originX = (int)bounds.origin(0) - radius;
+	originY = (int)bounds.origin(1) - radius;
+	cellsX  = ((int)bounds.extents(0) + 2*radius + cellSize - 1) / cellSize;
+	cellsY  = ((int)bounds.extents(1) + 2*radius + cellSize - 1) / cellSize;
+
+	cells.clear();
+	cells.resize(cellsX * cellsY);
+}
+
+/*
+ *    Class: CellGrid  
+ * Function: cellOf
+ * --------------------
+ * Cell of a location
+ * 
+ * x,y: location
+ *
+ * returns: cell index, -1 if the location is out of the grid
+ */
+int CellGrid::cellOf(int x, int y){
+	int dx = x - originX;
+	int dy = y - originY;
+
+	if (dx < 0 || dy < 0) return -1;
+	dx /= cellSize;
+	dy /= cellSize;
+	if (dx >= cellsX || dy >= cellsY) return -1;
+	return dy * cellsX + dx;
+}
+
+/*
+ *    Class: CellGrid  
+ * Function: update
+ * --------------------
+ * Bring the grid in line with the agents of the context, local and ghosts.
+ * Agents that stay in their cell only refresh their entry, the others are
+ * moved; entries of agents no longer in the context are dropped. Agents out
+ * of the grid (ghosts wrapped around the space borders) are left out, they
+ * can not be closer than the radius to a local agent.
+ * 
+ * context: Repast context
+ * space: Repast space
+ *
+ * returns: -
+ */
+void CellGrid::update(repast::SharedContext<RepastHPCAgent>* context,
+                      repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space){
+	uint32_t last = stamp++;
+
+	repast::SharedContext<RepastHPCAgent>::const_iterator iter    = context->begin();
+	repast::SharedContext<RepastHPCAgent>::const_iterator iterEnd = context->end();
+	while (iter != iterEnd){
+		RepastHPCAgent* a = *iter;
+		iter++;
+
+		agentLoc.clear();
+		space->getLocation(a->getId(), agentLoc);
+		int cell = cellOf(agentLoc[0], agentLoc[1]);
+
+		// Entry of the agent from the last update, if any
+		CellHandle h = a->getCellHandle();
+		CellEntry* e = nullptr;
+		if (h.cell >= 0 && h.cell < (int)cells.size() && h.slot < cells[h.cell].size() &&
+		    cells[h.cell][h.slot].agent == a && cells[h.cell][h.slot].stamp == last)
+			e = &cells[h.cell][h.slot];
+
+		if (e && h.cell == cell){
+			e->x     = agentLoc[0];
+			e->y     = agentLoc[1];
+			e->stamp = stamp;
+			continue;
+		}
+		if (cell < 0){
+			a->setCellHandle(CellHandle());
+			continue;
+		}
+		CellEntry entry = {a, agentLoc[0], agentLoc[1], a->getKey(), stamp};
+		h.cell = cell;
+		h.slot = cells[cell].size();
+		cells[cell].push_back(entry);
+		a->setCellHandle(h);
+	}
+
+	// Compact the cells, entries not refreshed belong to agents gone or moved
+	for (size_t c=0; c<cells.size(); c++){
+		std::vector<CellEntry>& cell = cells[c];
+		size_t kept = 0;
+		for (size_t i=0; i<cell.size(); i++){
+			if (cell[i].stamp != stamp) continue;
+			if (kept != i){
+				cell[kept] = cell[i];
+				CellHandle h;
+				h.cell = c;
+				h.slot = kept;
+				cell[kept].agent->setCellHandle(h);
+			}
+			kept++;
+		}
+		cell.resize(kept);
+	}
+}
@@ -0,0 +1,280 @@
+/* Checkpoint.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include "Checkpoint.h"
+
+/*
+ *    Class: Checkpoint  
+ * Function: Checkpoint
+ * --------------------
+ * Checkpoint constructor
+ * 
+ * _comm: processes of the model
+ * _file: checkpoint file
+ *
+ * returns: -
+ */
+Checkpoint::Checkpoint(MPI_Comm _comm, const std::string& _file): comm(_comm), file(_file), pending(false), fh(MPI_FILE_NULL){
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+	memset(&header, 0, sizeof(header));
+	memset(&entry, 0, sizeof(entry));
+}
+
+/*
+ *    Class: Checkpoint  
+ * Function: ~Checkpoint
+ * --------------------
+ * Checkpoint destructor, completes a write in flight (collective)
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+Checkpoint::~Checkpoint(){
+	finish();
+}
+
+/*
+ *    Class: Checkpoint  
+ * Function: recordBytes
+ * --------------------
+ * Bytes of a record in the file
+ * 
+ * comBufferSize: bytes of m
+ *
+ * returns: CheckpointRecord and m, rounded up to 8 bytes
+ */
+size_t Checkpoint::recordBytes(int comBufferSize){
+	return (sizeof(CheckpointRecord) + comBufferSize + 7) & ~(size_t)7;
+}
+
+/*
+ *    Class: Checkpoint  
+ * Function: pack
+ * --------------------
+ * Room for the records of this process in the next checkpoint, after the
+ * write in flight, if any, is complete (collective)
+ * 
+ * records: local agents
+ * comBufferSize: bytes of m
+ *
+ * returns: zeroed buffer of records, recordBytes(comBufferSize) apart
+ */
+char* Checkpoint::pack(size_t records, int comBufferSize){
+	finish();
+	header.comBufferSize = comBufferSize;
+	header.recordBytes = (int32_t)recordBytes(comBufferSize);
+	entry.records = records;
+	buffer.assign(records * header.recordBytes, 0);
+	return buffer.data();
+}
+
+/*
+ *    Class: Checkpoint  
+ * Function: write
+ * --------------------
+ * Start the write of the packed records (collective). The records of the
+ * processes go one after the other in rank order; every process writes its
+ * index entry, the first process the header.
+ * 
+ * tick: last tick run
+ * seed: run seed
+ * countOfAgents: next AgentId number of the process
+ *
+ * returns: -
+ */
+void Checkpoint::write(int tick, uint32_t seed, int64_t countOfAgents){
+	uint64_t records = entry.records, first = 0, total = 0;
+	MPI_Exscan(&records, &first, 1, MPI_UINT64_T, MPI_SUM, comm);
+	MPI_Allreduce(&records, &total, 1, MPI_UINT64_T, MPI_SUM, comm);
+	if (rank == 0) first = 0;
+
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.version = CHECKPOINT_VERSION;
+	header.seed = seed;
+	header.tick = tick;
+	header.ranks = size;
+	header.records = total;
+	entry.first = first;
+	entry.countOfAgents = countOfAgents;
+
+	std::string part = file + ".part";
+	if (MPI_File_open(comm, const_cast<char*>(part.c_str()), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+		throw std::runtime_error("Checkpoint: can not create " + part);
+	MPI_File_set_size(fh, 0);
+
+	MPI_Offset indexAt = sizeof(CheckpointHeader);
+	MPI_Offset recordsAt = indexAt + (MPI_Offset)size * sizeof(CheckpointRankEntry);
+	MPI_Datatype recordType;
+	MPI_Type_contiguous(header.recordBytes, MPI_BYTE, &recordType);
+	MPI_Type_commit(&recordType);
+
+	requests.assign(3, MPI_REQUEST_NULL);
+	if (rank == 0) MPI_File_iwrite_at(fh, 0, &header, sizeof(header), MPI_BYTE, &requests[0]);
+	MPI_File_iwrite_at(fh, indexAt + (MPI_Offset)rank * sizeof(entry), &entry, sizeof(entry), MPI_BYTE, &requests[1]);
+#if MPI_VERSION > 3 || (MPI_VERSION == 3 && MPI_SUBVERSION >= 1)
+	MPI_File_iwrite_at_all(fh, recordsAt + (MPI_Offset)first * header.recordBytes, buffer.data(), (int)records, recordType, &requests[2]);
+#else
+	MPI_File_iwrite_at(fh, recordsAt + (MPI_Offset)first * header.recordBytes, buffer.data(), (int)records, recordType, &requests[2]);
+#endif
+	MPI_Type_free(&recordType);
+	pending = true;
+}
+
+/*
+ *    Class: Checkpoint  
+ * Function: progress
+ * --------------------
+ * Let the write in flight advance, called every tick
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void Checkpoint::progress(){
+	int done;
+	if (pending) MPI_Testall((int)requests.size(), requests.data(), &done, MPI_STATUSES_IGNORE);
+}
+
+/*
+ *    Class: Checkpoint  
+ * Function: finish
+ * --------------------
+ * Complete the write in flight, if any, and put the file in place of the
+ * previous checkpoint (collective)
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void Checkpoint::finish(){
+	if (!pending) return;
+	MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+	MPI_File_close(&fh);
+	MPI_Barrier(comm);
+	if (rank == 0){
+		std::string part = file + ".part";
+		if (rename(part.c_str(), file.c_str()) != 0) perror(("Checkpoint: " + file).c_str());
+	}
+	pending = false;
+	std::vector<char>().swap(buffer);
+}
+
+/*
+ *    Class: Checkpoint  
+ * Function: restore
+ * --------------------
+ * Read a checkpoint for a process layout that may differ from the one that
+ * wrote it (collective). Every process reads an even share of the records,
+ * then the records go to the process owning their location.
+ * 
+ * comm: processes of the model
+ * file: checkpoint file
+ * bounds: xmin, ymin, xmax, ymax of this process, max excluded
+ * header: header of the file
+ * countOfAgents: next AgentId number of the process that had this rank, 0 if none
+ * records: records inside the bounds, header.recordBytes apart
+ *
+ * returns: -, throws std::runtime_error if the file can not be read or is not a checkpoint
+ */
+void Checkpoint::restore(MPI_Comm comm, const std::string& file, const int bounds[4], CheckpointHeader& header, int64_t* countOfAgents, std::vector<char>& records){
+	int rank, size;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+
+	MPI_File fh;
+	MPI_Status status;
+	if (MPI_File_open(comm, const_cast<char*>(file.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+		throw std::runtime_error("Checkpoint: can not open " + file);
+	MPI_File_read_at_all(fh, 0, &header, sizeof(header), MPI_BYTE, &status);
+	if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 || header.version != CHECKPOINT_VERSION || header.recordBytes < (int)sizeof(CheckpointRecord)){
+		MPI_File_close(&fh);
+		throw std::runtime_error("Checkpoint: " + file + " is not a checkpoint file");
+	}
+
+	CheckpointRankEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	MPI_File_read_at_all(fh, sizeof(header) + (MPI_Offset)rank * sizeof(entry), &entry, rank < header.ranks ? sizeof(entry) : 0, MPI_BYTE, &status);
+	*countOfAgents = entry.countOfAgents;
+
+	MPI_Datatype recordType;
+	MPI_Type_contiguous(header.recordBytes, MPI_BYTE, &recordType);
+	MPI_Type_commit(&recordType);
+
+	uint64_t begin = header.records * rank / size, end = header.records * (rank + 1) / size;
+	std::vector<char> share((end - begin) * header.recordBytes);
+	MPI_Offset recordsAt = sizeof(header) + (MPI_Offset)header.ranks * sizeof(CheckpointRankEntry);
+	MPI_File_read_at_all(fh, recordsAt + (MPI_Offset)begin * header.recordBytes, share.data(), (int)(end - begin), recordType, &status);
+	MPI_File_close(&fh);
+
+	//Owner of every cell of the grid made by the bounds of all the processes
+	std::vector<int> all(4 * size);
+	MPI_Allgather(const_cast<int*>(bounds), 4, MPI_INT, all.data(), 4, MPI_INT, comm);
+	std::vector<int> xs, ys;
+	for (int r = 0; r < size; r++){
+		xs.push_back(all[4 * r]);
+		ys.push_back(all[4 * r + 1]);
+	}
+	std::sort(xs.begin(), xs.end());
+	xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+	std::sort(ys.begin(), ys.end());
+	ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+	std::vector<int> cellOwner(xs.size() * ys.size(), 0);
+	for (int r = 0; r < size; r++){
+		size_t ix1 = std::lower_bound(xs.begin(), xs.end(), all[4 * r + 2]) - xs.begin();
+		size_t iy1 = std::lower_bound(ys.begin(), ys.end(), all[4 * r + 3]) - ys.begin();
+		for (size_t iy = std::lower_bound(ys.begin(), ys.end(), all[4 * r + 1]) - ys.begin(); iy < iy1; iy++)
+			for (size_t ix = std::lower_bound(xs.begin(), xs.end(), all[4 * r]) - xs.begin(); ix < ix1; ix++)
+				cellOwner[iy * xs.size() + ix] = r;
+	}
+
+	//Records grouped by owner
+	size_t n = end - begin;
+	std::vector<int> owner(n), sendCounts(size, 0), recvCounts(size), sendDispls(size, 0), recvDispls(size, 0);
+	for (size_t i = 0; i < n; i++){
+		const CheckpointRecord* r = (const CheckpointRecord*)&share[i * header.recordBytes];
+		size_t ix = std::max<long>(0, (std::upper_bound(xs.begin(), xs.end(), r->x) - xs.begin()) - 1);
+		size_t iy = std::max<long>(0, (std::upper_bound(ys.begin(), ys.end(), r->y) - ys.begin()) - 1);
+		owner[i] = cellOwner[iy * xs.size() + ix];
+		sendCounts[owner[i]]++;
+	}
+	MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, comm);
+	for (int r = 1; r < size; r++){
+		sendDispls[r] = sendDispls[r - 1] + sendCounts[r - 1];
+		recvDispls[r] = recvDispls[r - 1] + recvCounts[r - 1];
+	}
+	std::vector<char> send(share.size());
+	std::vector<int> next(sendDispls);
+	for (size_t i = 0; i < n; i++)
+		memcpy(&send[(size_t)next[owner[i]]++ * header.recordBytes], &share[i * header.recordBytes], header.recordBytes);
+
+	records.resize(((size_t)recvDispls[size - 1] + recvCounts[size - 1]) * header.recordBytes);
+	MPI_Alltoallv(send.data(), sendCounts.data(), sendDispls.data(), recordType,
+	              records.data(), recvCounts.data(), recvDispls.data(), recordType, comm);
+	MPI_Type_free(&recordType);
+}
@@ -0,0 +1,594 @@
+/* CommMetrics.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <boost/mpi/collectives.hpp>
+#include <boost/serialization/vector.hpp>
+#include "CommMetrics.h"
+
+/* Values kept per phase and tick: messages, bytes, packages sent, packages received, seconds */
+#define TICK_VALUES 5
+#define TICK_FIELDS (1 + NUM_COMM_PHASES * TICK_VALUES)
+
+/* Ranks of a communicator in the communicator metrics are kept for, and its
+   neighborhood collective destinations */
+struct CommPeers {
+	MPI_Comm		comm;
+	int			self;
+	std::vector<int>	ranks;
+	std::vector<int>	destinations;
+};
+
+static bool active = false;
+static MPI_Group metricsGroup;
+static int metricsSize = 0;
+static int current = COMM_OTHER;
+static double phaseStarted = 0;
+static double tickValues[NUM_COMM_PHASES][TICK_VALUES];
+static std::vector<double> history;		// TICK_FIELDS per tick: tick number, then tickValues
+static std::vector<uint64_t> peerMessages;	// NUM_COMM_PHASES x (metricsSize + 1), last column collectives without one peer
+static std::vector<uint64_t> peerBytes;
+static std::vector<CommPeers> peerMaps;
+
+/*
+ * Function: peersOf
+ * --------------------
+ * Get, building it on first use, the rank translation of a communicator
+ * 
+ * comm: mpi communicator
+ *
+ * returns: ranks of comm in the metrics communicator (metricsSize if not in
+ *          it) and destinations of its topology, if any
+ */
+static CommPeers& peersOf(MPI_Comm comm){
+	for (size_t i=0; i<peerMaps.size(); i++)
+		if (peerMaps[i].comm == comm) return peerMaps[i];
+
+	peerMaps.resize(peerMaps.size() + 1);
+	CommPeers& peers = peerMaps.back();
+	MPI_Group group;
+	int inter, n, topology;
+
+	peers.comm = comm;
+	PMPI_Comm_rank(comm, &peers.self);
+	PMPI_Comm_test_inter(comm, &inter);
+	if (inter){
+		PMPI_Comm_remote_group(comm, &group);
+		peers.self = -1;
+	} else {
+		PMPI_Comm_group(comm, &group);
+	}
+	PMPI_Group_size(group, &n);
+	std::vector<int> ranks(n);
+	for (int i=0; i<n; i++) ranks[i] = i;
+	peers.ranks.resize(n);
+	PMPI_Group_translate_ranks(group, n, ranks.data(), metricsGroup, peers.ranks.data());
+	for (int i=0; i<n; i++)
+		if (peers.ranks[i] == MPI_UNDEFINED) peers.ranks[i] = metricsSize;
+	PMPI_Group_free(&group);
+
+	PMPI_Topo_test(comm, &topology);
+	if (topology == MPI_DIST_GRAPH){
+		int in, out, weighted;
+		PMPI_Dist_graph_neighbors_count(comm, &in, &out, &weighted);
+		std::vector<int> sources(in);
+		peers.destinations.resize(out);
+		PMPI_Dist_graph_neighbors(comm, in, sources.data(), MPI_UNWEIGHTED, out, peers.destinations.data(), MPI_UNWEIGHTED);
+	} else if (topology == MPI_CART){
+		int dims, source, destination;
+		PMPI_Cartdim_get(comm, &dims);
+		for (int d=0; d<dims; d++){
+			PMPI_Cart_shift(comm, d, 1, &source, &destination);
+			peers.destinations.push_back(source);
+			peers.destinations.push_back(destination);
+		}
+	} else if (topology == MPI_GRAPH){
+		int k;
+		PMPI_Graph_neighbors_count(comm, peers.self, &k);
+		peers.destinations.resize(k);
+		PMPI_Graph_neighbors(comm, peers.self, k, peers.destinations.data());
+	}
+	return peers;
+}
+
+/*
+ * Function: forget
+ * --------------------
+ * Drop the rank translation of a communicator about to be freed, its handle
+ * may be reused
+ * 
+ * comm: mpi communicator
+ *
+ * returns: -
+ */
+static void forget(MPI_Comm comm){
+	for (size_t i=0; i<peerMaps.size(); i++)
+		if (peerMaps[i].comm == comm){
+			peerMaps.erase(peerMaps.begin() + i);
+			return;
+		}
+}
+
+/*
+ * Function: count
+ * --------------------
+ * Account a message to the current phase and tick
+ * 
+ * peer: rank in the metrics communicator, metricsSize for a collective
+ *       without a single peer
+ * bytes: message size
+ *
+ * returns: -
+ */
+static inline void count(int peer, uint64_t bytes){
+	size_t k = current * (metricsSize + 1) + peer;
+	tickValues[current][0]++;
+	tickValues[current][1] += bytes;
+	peerMessages[k]++;
+	peerBytes[k] += bytes;
+}
+
+/*
+ * Function: typeBytes
+ * --------------------
+ * Get the bytes of count items of a datatype
+ * 
+ * count: number of items
+ * type: mpi datatype
+ *
+ * returns: bytes
+ */
+static inline uint64_t typeBytes(int count, MPI_Datatype type){
+	int size;
+	PMPI_Type_size(type, &size);
+	return (uint64_t)count * size;
+}
+
+/*
+ * Function: countSend
+ * --------------------
+ * Account a point to point message
+ * 
+ * comm: mpi communicator
+ * dest: destination rank in comm
+ * n: number of items
+ * type: mpi datatype
+ *
+ * returns: -
+ */
+static void countSend(MPI_Comm comm, int dest, int n, MPI_Datatype type){
+	if (dest == MPI_PROC_NULL) return;
+	count(peersOf(comm).ranks[dest], typeBytes(n, type));
+}
+
+/*
+ * Function: countAll
+ * --------------------
+ * Account an all to all exchange, one message to every other rank of the
+ * communicator
+ * 
+ * comm: mpi communicator
+ * counts: items sent to each rank, NULL if all send n
+ * n: items sent to each rank if counts is NULL
+ * type: mpi datatype
+ *
+ * returns: -
+ */
+static void countAll(MPI_Comm comm, const int* counts, int n, MPI_Datatype type){
+	CommPeers& peers = peersOf(comm);
+	for (size_t r=0; r<peers.ranks.size(); r++)
+		if ((int)r != peers.self) count(peers.ranks[r], typeBytes(counts ? counts[r] : n, type));
+}
+
+/*
+ * Function: countNeighbors
+ * --------------------
+ * Account a neighborhood collective, one message to every destination of the
+ * topology of the communicator
+ * 
+ * comm: mpi communicator with a topology
+ * counts: items sent to each destination, NULL if all send n
+ * n: items sent to each destination if counts is NULL
+ * type: mpi datatype
+ *
+ * returns: -
+ */
+static void countNeighbors(MPI_Comm comm, const int* counts, int n, MPI_Datatype type){
+	CommPeers& peers = peersOf(comm);
+	for (size_t i=0; i<peers.destinations.size(); i++)
+		if (peers.destinations[i] != MPI_PROC_NULL) count(peers.ranks[peers.destinations[i]], typeBytes(counts ? counts[i] : n, type));
+}
+
+/*
+ * Function: countCollective
+ * --------------------
+ * Account the contribution of the process to a collective without a single
+ * peer (reductions, gathers, broadcasts)
+ * 
+ * n: number of items
+ * type: mpi datatype
+ *
+ * returns: -
+ */
+static void countCollective(int n, MPI_Datatype type){
+	count(metricsSize, typeBytes(n, type));
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: intercepting
+ * --------------------
+ * Check if MPI messages and bytes are counted
+ * 
+ * -: -
+ *
+ * returns: false if compiled with COMM_NO_INTERCEPT
+ */
+bool CommMetrics::intercepting(){
+#ifdef COMM_NO_INTERCEPT
+	return false;
+#else
+	return true;
+#endif
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: enable
+ * --------------------
+ * Start counting, peers are identified by their rank in a communicator
+ * 
+ * comm: mpi communicator of the model
+ *
+ * returns: -
+ */
+void CommMetrics::enable(MPI_Comm comm){
+	PMPI_Comm_group(comm, &metricsGroup);
+	PMPI_Comm_size(comm, &metricsSize);
+	peerMessages.assign(NUM_COMM_PHASES * (metricsSize + 1), 0);
+	peerBytes.assign(NUM_COMM_PHASES * (metricsSize + 1), 0);
+	for (int i=0; i<NUM_COMM_PHASES; i++)
+		for (int j=0; j<TICK_VALUES; j++) tickValues[i][j] = 0;
+	current = COMM_OTHER;
+	active = true;
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: enabled
+ * --------------------
+ * Check if communication is being counted
+ * 
+ * -: -
+ *
+ * returns: true once enabled, until the report
+ */
+bool CommMetrics::enabled(){
+	return active;
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: phaseName
+ * --------------------
+ * Get the name of a phase
+ * 
+ * phase: phase
+ *
+ * returns: name used in the report
+ */
+const char* CommMetrics::phaseName(CommPhase phase){
+	static const char* names[NUM_COMM_PHASES] = { "other", "balance", "status", "projection", "states", "halo", "rebalance" };
+	return names[phase];
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: begin
+ * --------------------
+ * Account the communication from now on to a phase and start timing it,
+ * ending the running phase if any
+ * 
+ * phase: phase
+ *
+ * returns: -
+ */
+void CommMetrics::begin(CommPhase phase){
+	if (!active) return;
+	double now = MPI_Wtime();
+	if (current != COMM_OTHER) tickValues[current][4] += now - phaseStarted;
+	current = phase;
+	phaseStarted = now;
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: end
+ * --------------------
+ * Stop timing the current phase, what follows is accounted to COMM_OTHER
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void CommMetrics::end(){
+	if (!active) return;
+	tickValues[current][4] += MPI_Wtime() - phaseStarted;
+	current = COMM_OTHER;
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: packagesSent
+ * --------------------
+ * Account agent packages (or deltas) given to an exchange
+ * 
+ * n: number of packages
+ *
+ * returns: -
+ */
+void CommMetrics::packagesSent(size_t n){
+	if (active) tickValues[current][2] += n;
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: packagesReceived
+ * --------------------
+ * Account agent packages (or deltas) taken from an exchange
+ * 
+ * n: number of packages
+ *
+ * returns: -
+ */
+void CommMetrics::packagesReceived(size_t n){
+	if (active) tickValues[current][3] += n;
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: endTick
+ * --------------------
+ * Keep the counts of a tick and start the next one
+ * 
+ * tick: tick number
+ *
+ * returns: -
+ */
+void CommMetrics::endTick(int tick){
+	if (!active) return;
+	history.push_back(tick);
+	for (int i=0; i<NUM_COMM_PHASES; i++)
+		for (int j=0; j<TICK_VALUES; j++){
+			history.push_back(tickValues[i][j]);
+			tickValues[i][j] = 0;
+		}
+}
+
+/*
+ *    Class: CommMetrics  
+ * Function: report
+ * --------------------
+ * Stop counting and reduce the counts over all processes. Rank 0 prints the
+ * totals per phase and writes comm_ticks.csv, one row per tick and phase
+ * with messages, bytes, packages sent and received summed over processes,
+ * the max bytes of a process and max and mean wall time in msecs, and
+ * comm_peers.csv, messages and bytes every process sent to every peer rank
+ * per phase over the run (peer "all" for reductions, gathers and broadcasts).
+ * A message received is the row of its sender.
+ * 
+ * comm: mpi communicator, the one metrics were enabled with
+ * dir: output directory
+ *
+ * returns: -
+ */
+void CommMetrics::report(boost::mpi::communicator* comm, std::string dir){
+	if (!active) return;
+	active = false;
+
+	int localTicks = history.size() / TICK_FIELDS, ticks;
+	boost::mpi::all_reduce(*comm, localTicks, ticks, boost::mpi::maximum<int>());
+	history.resize((size_t)ticks * TICK_FIELDS, 0);
+
+	std::vector<double> sums(history.size()), maxima(history.size());
+	if (ticks > 0){
+		boost::mpi::reduce(*comm, history.data(), history.size(), sums.data(), std::plus<double>(), 0);
+		boost::mpi::reduce(*comm, history.data(), history.size(), maxima.data(), boost::mpi::maximum<double>(), 0);
+	}
+
+	std::vector<double> local;
+	for (int p=0; p<NUM_COMM_PHASES; p++)
+		for (int r=0; r<=metricsSize; r++){
+			size_t k = p * (metricsSize + 1) + r;
+			if (peerMessages[k] == 0) continue;
+			local.push_back(r);
+			local.push_back(p);
+			local.push_back(peerMessages[k]);
+			local.push_back(peerBytes[k]);
+		}
+	std::vector<std::vector<double> > peers;
+	boost::mpi::gather(*comm, local, peers, 0);
+	PMPI_Group_free(&metricsGroup);
+
+	if (comm->rank() != 0) return;
+
+	double totals[NUM_COMM_PHASES][TICK_VALUES] = {};
+	FILE *fp = fopen((dir + "/comm_ticks.csv").c_str(), "w");
+	if (fp != NULL) fprintf(fp, "tick,phase,messages,bytes,max_bytes,packages_sent,packages_received,max_msecs,mean_msecs\n");
+	for (int t=0; t<ticks; t++){
+		const double* sum = &sums[t * TICK_FIELDS + 1];
+		const double* max = &maxima[t * TICK_FIELDS + 1];
+		for (int p=0; p<NUM_COMM_PHASES; p++){
+			const double* s = sum + p * TICK_VALUES;
+			const double* m = max + p * TICK_VALUES;
+			for (int j=0; j<TICK_VALUES; j++) totals[p][j] += s[j];
+			if (s[0] == 0 && s[2] == 0 && s[3] == 0 && s[4] == 0) continue;
+			if (fp != NULL) fprintf(fp, "%d,%s,%.0f,%.0f,%.0f,%.0f,%.0f,%.3f,%.3f\n", (int)maxima[t * TICK_FIELDS], phaseName((CommPhase)p),
+			                        s[0], s[1], m[1], s[2], s[3], m[4] * 1000.0, s[4] * 1000.0 / comm->size());
+		}
+	}
+	if (fp != NULL) fclose(fp);
+
+	fp = fopen((dir + "/comm_peers.csv").c_str(), "w");
+	if (fp != NULL) fprintf(fp, "rank,peer,phase,messages,bytes\n");
+	for (size_t r=0; r<peers.size(); r++)
+		for (size_t i=0; i+3<peers[r].size(); i+=4){
+			int peer = (int)peers[r][i];
+			if (fp == NULL) break;
+			if (peer == metricsSize) fprintf(fp, "%d,all,%s,%.0f,%.0f\n", (int)r, phaseName((CommPhase)(int)peers[r][i + 1]), peers[r][i + 2], peers[r][i + 3]);
+			else fprintf(fp, "%d,%d,%s,%.0f,%.0f\n", (int)r, peer, phaseName((CommPhase)(int)peers[r][i + 1]), peers[r][i + 2], peers[r][i + 3]);
+		}
+	if (fp != NULL) fclose(fp);
+
+	for (int p=0; p<NUM_COMM_PHASES; p++){
+		if (totals[p][0] == 0 && totals[p][2] == 0 && totals[p][4] == 0) continue;
+		std::cout << "Comm " << phaseName((CommPhase)p) << ": messages " << totals[p][0] << " bytes " << totals[p][1]
+		          << " packages sent " << totals[p][2] << " received " << totals[p][3]
+		          << " mean msecs " << totals[p][4] * 1000.0 / comm->size() << std::endl;
+	}
+}
+
+#ifndef COMM_NO_INTERCEPT
+
+/* MPI profiling interface wrappers: account what is sent and call the PMPI version */
+extern "C" {
+
+int MPI_Send(const void* buf, int n, MPI_Datatype type, int dest, int tag, MPI_Comm comm){
+	if (active) countSend(comm, dest, n, type);
+	return PMPI_Send(buf, n, type, dest, tag, comm);
+}
+
+int MPI_Ssend(const void* buf, int n, MPI_Datatype type, int dest, int tag, MPI_Comm comm){
+	if (active) countSend(comm, dest, n, type);
+	return PMPI_Ssend(buf, n, type, dest, tag, comm);
+}
+
+int MPI_Isend(const void* buf, int n, MPI_Datatype type, int dest, int tag, MPI_Comm comm, MPI_Request* request){
+	if (active) countSend(comm, dest, n, type);
+	return PMPI_Isend(buf, n, type, dest, tag, comm, request);
+}
+
+int MPI_Issend(const void* buf, int n, MPI_Datatype type, int dest, int tag, MPI_Comm comm, MPI_Request* request){
+	if (active) countSend(comm, dest, n, type);
+	return PMPI_Issend(buf, n, type, dest, tag, comm, request);
+}
+
+int MPI_Alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm){
+	if (active){
+		if (sendbuf == MPI_IN_PLACE) countAll(comm, NULL, recvcount, recvtype);
+		else countAll(comm, NULL, sendcount, sendtype);
+	}
+	return PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+}
+
+int MPI_Alltoallv(const void* sendbuf, const int sendcounts[], const int sdispls[], MPI_Datatype sendtype,
+                  void* recvbuf, const int recvcounts[], const int rdispls[], MPI_Datatype recvtype, MPI_Comm comm){
+	if (active){
+		if (sendbuf == MPI_IN_PLACE) countAll(comm, recvcounts, 0, recvtype);
+		else countAll(comm, sendcounts, 0, sendtype);
+	}
+	return PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+}
+
+int MPI_Neighbor_alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm){
+	if (active) countNeighbors(comm, NULL, sendcount, sendtype);
+	return PMPI_Neighbor_alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+}
+
+int MPI_Ineighbor_alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype,
+                           MPI_Comm comm, MPI_Request* request){
+	if (active) countNeighbors(comm, NULL, sendcount, sendtype);
+	return PMPI_Ineighbor_alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm, request);
+}
+
+int MPI_Neighbor_alltoallv(const void* sendbuf, const int sendcounts[], const int sdispls[], MPI_Datatype sendtype,
+                           void* recvbuf, const int recvcounts[], const int rdispls[], MPI_Datatype recvtype, MPI_Comm comm){
+	if (active) countNeighbors(comm, sendcounts, 0, sendtype);
+	return PMPI_Neighbor_alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+}
+
+int MPI_Ineighbor_alltoallv(const void* sendbuf, const int sendcounts[], const int sdispls[], MPI_Datatype sendtype,
+                            void* recvbuf, const int recvcounts[], const int rdispls[], MPI_Datatype recvtype, MPI_Comm comm, MPI_Request* request){
+	if (active) countNeighbors(comm, sendcounts, 0, sendtype);
+	return PMPI_Ineighbor_alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm, request);
+}
+
+int MPI_Neighbor_allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm){
+	if (active) countNeighbors(comm, NULL, sendcount, sendtype);
+	return PMPI_Neighbor_allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+}
+
+int MPI_Neighbor_allgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                            void* recvbuf, const int recvcounts[], const int displs[], MPI_Datatype recvtype, MPI_Comm comm){
+	if (active) countNeighbors(comm, NULL, sendcount, sendtype);
+	return PMPI_Neighbor_allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int n, MPI_Datatype type, MPI_Op op, MPI_Comm comm){
+	if (active) countCollective(n, type);
+	return PMPI_Allreduce(sendbuf, recvbuf, n, type, op, comm);
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int n, MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm){
+	if (active) countCollective(n, type);
+	return PMPI_Reduce(sendbuf, recvbuf, n, type, op, root, comm);
+}
+
+int MPI_Bcast(void* buf, int n, MPI_Datatype type, int root, MPI_Comm comm){
+	if (active && peersOf(comm).self == root) countCollective(n, type);
+	return PMPI_Bcast(buf, n, type, root, comm);
+}
+
+int MPI_Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm){
+	if (active) countCollective(sendbuf == MPI_IN_PLACE ? recvcount : sendcount, sendbuf == MPI_IN_PLACE ? recvtype : sendtype);
+	return PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+}
+
+int MPI_Allgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                   void* recvbuf, const int recvcounts[], const int displs[], MPI_Datatype recvtype, MPI_Comm comm){
+	if (active && sendbuf != MPI_IN_PLACE) countCollective(sendcount, sendtype);
+	return PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
+}
+
+int MPI_Gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm){
+	if (active && sendbuf != MPI_IN_PLACE) countCollective(sendcount, sendtype);
+	return PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+}
+
+int MPI_Gatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                void* recvbuf, const int recvcounts[], const int displs[], MPI_Datatype recvtype, int root, MPI_Comm comm){
+	if (active && sendbuf != MPI_IN_PLACE) countCollective(sendcount, sendtype);
+	return PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+}
+
+int MPI_Comm_free(MPI_Comm* comm){
+	forget(*comm);
+	return PMPI_Comm_free(comm);
+}
+
+}
+
+#endif
@@ -0,0 +1,229 @@
+/* FFTPlanCache.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdexcept>
+#include <boost/mpi/collectives.hpp>
+#include "FFTPlanCache.h"
+
+/*
+ *    Class: FFTPlanCache  
+ * Function: FFTPlanCache
+ * --------------------
+ * FFTPlanCache constructor
+ * 
+ * plannerMode: FFTW planner rigor, ESTIMATE, MEASURE or PATIENT
+ * _wisdomFile: FFTW wisdom file, empty to disable wisdom import/export
+ *
+ * returns: -
+ */
+FFTPlanCache::FFTPlanCache(std::string plannerMode, std::string _wisdomFile): flags(plannerFlags(plannerMode)), wisdomFile(_wisdomFile){
+}
+
+/*
+ *    Class: FFTPlanCache  
+ * Function: ~FFTPlanCache
+ * --------------------
+ * FFTPlanCache destructor, destroys plans and frees batch and output buffers
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+FFTPlanCache::~FFTPlanCache(){
+	for (std::map<Key, fftw_plan>::iterator it = plans.begin(); it != plans.end(); it++)
+		fftw_destroy_plan(it->second);
+	for (std::map<Slot, fftw_complex*>::iterator it = inputs.begin(); it != inputs.end(); it++)
+		fftw_free(it->second);
+	for (std::map<Slot, fftw_complex*>::iterator it = buffers.begin(); it != buffers.end(); it++)
+		fftw_free(it->second);
+}
+
+/*
+ *    Class: FFTPlanCache  
+ * Function: plannerFlags
+ * --------------------
+ * Translate a planner mode name into FFTW planner flags
+ * 
+ * plannerMode: ESTIMATE, MEASURE or PATIENT
+ *
+ * returns: FFTW planner flags
+ */
+unsigned FFTPlanCache::plannerFlags(std::string plannerMode){
+	if (plannerMode == "" || plannerMode == "ESTIMATE") return FFTW_ESTIMATE;
+	if (plannerMode == "MEASURE") return FFTW_MEASURE;
+	if (plannerMode == "PATIENT") return FFTW_PATIENT;
+	throw std::invalid_argument("Unknown FFT planner mode: " + plannerMode);
+}
+
+/*
+ *    Class: FFTPlanCache  
+ * Function: allocate
+ * --------------------
+ * Get the aligned array holding howmany contiguous vectors of size N, allocating it on first use
+ * 
+ * arrays: input or output arrays of the cache
+ * N: FFT vector size
+ * howmany: number of vectors
+ * slot: thread owning the array
+ *
+ * returns: array
+ */
+fftw_complex* FFTPlanCache::allocate(std::map<Slot, fftw_complex*>& arrays, int N, int howmany, int slot){
+	Slot key(Key(N, howmany), slot);
+	std::map<Slot, fftw_complex*>::iterator it = arrays.find(key);
+	if (it != arrays.end()) return it->second;
+	fftw_complex *a = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N * howmany);
+	arrays[key] = a;
+	return a;
+}
+
+/*
+ *    Class: FFTPlanCache  
+ * Function: createPlan
+ * --------------------
+ * Create a forward plan of howmany contiguous vectors of size N. MEASURE and
+ * PATIENT overwrite the arrays while planning, so single vector plans are built
+ * on a scratch array and later run on the agents input vector through
+ * fftw_execute_dft (all arrays come from fftw_malloc, so they share the SIMD
+ * alignment the plan expects). Batch plans are built on their own input array,
+ * which is filled by the caller before every execution.
+ * 
+ * N: FFT vector size
+ * howmany: number of vectors transformed by one execution
+ *
+ * returns: FFTW plan
+ */
+fftw_plan FFTPlanCache::createPlan(int N, int howmany){
+	fftw_plan p;
+
+	if (howmany == 1){
+		fftw_complex *scratch = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+		p = fftw_plan_dft_1d(N, scratch, buffer(N, 1), FFTW_FORWARD, flags);
+		fftw_free(scratch);
+	} else {
+		p = fftw_plan_many_dft(1, &N, howmany, input(N, howmany), NULL, 1, N, buffer(N, howmany), NULL, 1, N, FFTW_FORWARD, flags);
+	}
+	plans[Key(N, howmany)] = p;
+	return p;
+}
+
+/*
+ *    Class: FFTPlanCache  
+ * Function: prepare
+ * --------------------
+ * Build the single vector plan of size N, and the batch plan when howmany > 1,
+ * on every process. Rank 0 loads the wisdom file, plans and broadcasts the
+ * resulting wisdom, so the other processes plan from wisdom instead of
+ * measuring again. Rank 0 saves the wisdom for later runs.
+ * Buffers of every slot are allocated here: lookups done afterwards from
+ * several threads only read the cache.
+ * 
+ * N: FFT vector size
+ * howmany: batch size, 1 for no batch plan
+ * slots: number of threads using the cache
+ * comm: mpi communicator
+ *
+ * returns: -
+ */
+void FFTPlanCache::prepare(int N, int howmany, int slots, boost::mpi::communicator* comm){
+	std::string wisdom;
+
+	if (comm->rank() == 0){
+		if (wisdomFile != "") fftw_import_wisdom_from_filename(wisdomFile.c_str());
+		createPlan(N, 1);
+		if (howmany > 1) createPlan(N, howmany);
+		char *w = fftw_export_wisdom_to_string();
+		if (w != NULL){
+			wisdom = w;
+			free(w);
+		}
+		if (wisdomFile != "") fftw_export_wisdom_to_filename(wisdomFile.c_str());
+	}
+
+	boost::mpi::broadcast(*comm, wisdom, 0);
+
+	if (comm->rank() != 0){
+		if (wisdom != "") fftw_import_wisdom_from_string(wisdom.c_str());
+		createPlan(N, 1);
+		if (howmany > 1) createPlan(N, howmany);
+	}
+
+	for (int slot=0; slot<slots; slot++){
+		buffer(N, 1, slot);
+		if (howmany > 1){
+			input(N, howmany, slot);
+			buffer(N, howmany, slot);
+		}
+	}
+}
+
+/*
+ *    Class: FFTPlanCache  
+ * Function: plan
+ * --------------------
+ * Get the plan of howmany vectors of size N, creating it if it was not prepared
+ * (creating is not thread safe, threads must only use prepared plans)
+ * 
+ * N: FFT vector size
+ * howmany: number of vectors
+ *
+ * returns: FFTW plan
+ */
+fftw_plan FFTPlanCache::plan(int N, int howmany){
+	std::map<Key, fftw_plan>::iterator it = plans.find(Key(N, howmany));
+	if (it != plans.end()) return it->second;
+	return createPlan(N, howmany);
+}
+
+/*
+ *    Class: FFTPlanCache  
+ * Function: input
+ * --------------------
+ * Get the contiguous input array of a batch plan
+ * 
+ * N: FFT vector size
+ * howmany: number of vectors
+ * slot: thread owning the array
+ *
+ * returns: input array, vector i starts at i*N
+ */
+fftw_complex* FFTPlanCache::input(int N, int howmany, int slot){
+	return allocate(inputs, N, howmany, slot);
+}
+
+/*
+ *    Class: FFTPlanCache  
+ * Function: buffer
+ * --------------------
+ * Get the aligned output array of a plan
+ * 
+ * N: FFT vector size
+ * howmany: number of vectors
+ * slot: thread owning the array
+ *
+ * returns: output array, vector i starts at i*N
+ */
+fftw_complex* FFTPlanCache::buffer(int N, int howmany, int slot){
+	return allocate(buffers, N, howmany, slot);
+}
@@ -0,0 +1,176 @@
+/* FFTVector.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "FFTVector.h"
+#include "Scenario.h"
+
+/*
+ *    Class: FFTVector  
+ * Function: FFTVector
+ * --------------------
+ * FFTVector constructor, collective over comm for a binary file
+ * 
+ * file: FFT vector file
+ * binary: true for a binary file, shared by the processes of a node
+ * comm: processes of the model
+ *
+ * returns: -, throws std::runtime_error if the file can not be read
+ */
+FFTVector::FFTVector(const std::string& file, bool binary, MPI_Comm comm): N(0), values(nullptr), shared(false), node(MPI_COMM_NULL), window(MPI_WIN_NULL){
+	if (binary) loadShared(file, comm);
+	else loadText(file);
+}
+
+/*
+ *    Class: FFTVector  
+ * Function: FFTVector
+ * --------------------
+ * FFTVector constructor, generates the vector without a file
+ * 
+ * _N: vector size
+ * seed: scenario seed
+ *
+ * returns: -
+ */
+FFTVector::FFTVector(int _N, uint32_t seed): N(_N), values(nullptr), shared(false), node(MPI_COMM_NULL), window(MPI_WIN_NULL){
+	if (N < 1) throw std::runtime_error("FFTVector: the vector size must be positive");
+	values = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+	for (int i = 0; i < N; i++) Scenario::fftValue(i, seed, values[i]);
+}
+
+/*
+ *    Class: FFTVector  
+ * Function: ~FFTVector
+ * --------------------
+ * FFTVector destructor
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+FFTVector::~FFTVector(){
+	if (shared){
+		MPI_Win_unlock_all(window);
+		MPI_Win_free(&window);
+		MPI_Comm_free(&node);
+	} else {
+		fftw_free(values);
+	}
+}
+
+/*
+ *    Class: FFTVector  
+ * Function: loadText
+ * --------------------
+ * Parse a text file into a private copy
+ * 
+ * file: FFT vector file
+ *
+ * returns: -
+ */
+void FFTVector::loadText(const std::string& file){
+	FILE* fp = fopen(file.c_str(), "r");
+	if (fp == NULL) throw std::runtime_error("FFTVector: can not open " + file);
+
+	if (fscanf(fp, "%d", &N) != 1 || N < 1){
+		fclose(fp);
+		throw std::runtime_error("FFTVector: no vector size in " + file);
+	}
+	values = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+	for (int i = 0; i < N; i++)
+		if (fscanf(fp, "%lf %lf", &values[i][0], &values[i][1]) != 2) break;
+	fclose(fp);
+}
+
+/*
+ *    Class: FFTVector  
+ * Function: loadShared
+ * --------------------
+ * Map a binary file on the first process of every node and copy it into a
+ * window shared with the node, collective over comm. The other processes of
+ * the node do not touch the file.
+ * 
+ * file: FFT vector file
+ * comm: processes of the model
+ *
+ * returns: -
+ */
+void FFTVector::loadShared(const std::string& file, MPI_Comm comm){
+	int rank, nodeRank;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+	MPI_Comm_rank(node, &nodeRank);
+
+	//The first process of the node maps the file, the node learns the size (0 if it is not valid)
+	uint64_t n = 0;
+	const char* mapped = (const char*) MAP_FAILED;
+	size_t mappedBytes = 0;
+	if (nodeRank == 0){
+		int fd = open(file.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd >= 0 && fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(FFTVectorHeader)){
+			mappedBytes = st.st_size;
+			mapped = (const char*) mmap(NULL, mappedBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped != MAP_FAILED && fftVectorValid(*(const FFTVectorHeader*)mapped, mappedBytes))
+				n = ((const FFTVectorHeader*)mapped)->N;
+		}
+		if (fd >= 0) close(fd);
+	}
+	MPI_Bcast(&n, 1, MPI_UINT64_T, 0, node);
+	if (n == 0 || n > INT32_MAX){
+		if (mapped != MAP_FAILED) munmap((void*)mapped, mappedBytes);
+		MPI_Comm_free(&node);
+		throw std::runtime_error("FFTVector: " + file + " is not a binary FFT vector file");
+	}
+	N = (int)n;
+
+	//Only the first process of the node allocates, room to align the values as fftw_malloc does
+	size_t bytes = sizeof(fftw_complex) * n;
+	char* base;
+	MPI_Win_allocate_shared(nodeRank == 0 ? (MPI_Aint)(bytes + FFT_VECTOR_ALIGN) : 0, 1, MPI_INFO_NULL, node, &base, &window);
+	MPI_Aint windowBytes;
+	int unit;
+	MPI_Win_shared_query(window, 0, &windowBytes, &unit, &base);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+	shared = true;
+
+	//The window is mapped at a page boundary in every process, the offset is the same for all
+	size_t offset = (FFT_VECTOR_ALIGN - (uintptr_t)base % FFT_VECTOR_ALIGN) % FFT_VECTOR_ALIGN;
+	values = (fftw_complex*)(base + offset);
+
+	if (nodeRank == 0){
+		memcpy(values, mapped + sizeof(FFTVectorHeader), bytes);
+		munmap((void*)mapped, mappedBytes);
+	}
+	MPI_Win_sync(window);
+	MPI_Barrier(node);
+	MPI_Win_sync(window);
+}
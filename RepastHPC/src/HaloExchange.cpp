@@ -0,0 +1,1042 @@
+/* HaloExchange.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include "HaloExchange.h"
+#include "Model.h"
+#include "CommMetrics.h"
+
+/*
+ *    Class: HaloExchange  
+ * Function: HaloExchange
+ * --------------------
+ * HaloExchange constructor, gathers the bounds of every process to locate
+ * owners and neighbors and builds the neighborhood communicator
+ * 
+ * comm: model communicator
+ * bounds: local bounds of the process
+ * _width,_height: size of the space
+ * _buffer: width of the ghost area around the local bounds
+ *
+ * returns: -
+ */
+HaloExchange::HaloExchange(MPI_Comm comm, const repast::GridDimensions& bounds, int _width, int _height, int _buffer): world(comm), width(_width), height(_height), buffer(_buffer), stage(0), interest(false), radius(0), interestCell(1), frameCellsX(0), frameCellsY(0), shared(false), slotSize(0), generation(0), codec(nullptr){
+	int size;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+
+	originX = bounds.origin().getX();
+	originY = bounds.origin().getY();
+	extentX = bounds.extents().getX();
+	extentY = bounds.extents().getY();
+
+	int mine[2] = {originX, originY};
+	std::vector<int> origins(2 * size);
+	MPI_Allgather(mine, 2, MPI_INT, origins.data(), 2, MPI_INT, comm);
+
+	for (int r=0; r<size; r++){
+		startX.push_back(origins[2*r]);
+		startY.push_back(origins[2*r + 1]);
+	}
+	std::sort(startX.begin(), startX.end());
+	startX.erase(std::unique(startX.begin(), startX.end()), startX.end());
+	std::sort(startY.begin(), startY.end());
+	startY.erase(std::unique(startY.begin(), startY.end()), startY.end());
+
+	int cols = startX.size();
+	rankAt.resize(cols * startY.size());
+	column.resize(size);
+	row.resize(size);
+	for (int r=0; r<size; r++){
+		column[r] = std::lower_bound(startX.begin(), startX.end(), origins[2*r]) - startX.begin();
+		row[r]    = std::lower_bound(startY.begin(), startY.end(), origins[2*r + 1]) - startY.begin();
+		rankAt[row[r] * cols + column[r]] = r;
+	}
+
+	buildGraph(comm);
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: ~HaloExchange
+ * --------------------
+ * HaloExchange destructor
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+HaloExchange::~HaloExchange(){
+	if (shared){
+		MPI_Win_unlock_all(window);
+		MPI_Win_free(&window);
+		MPI_Comm_free(&node);
+	}
+	MPI_Comm_free(&graph);
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: buildGraph
+ * --------------------
+ * Find the neighbors of the process in the periodic process grid, the same
+ * process may be the neighbor of several directions when the grid has less
+ * than three processes along an axis, and create a distributed graph
+ * communicator over the distinct ones. A Cartesian communicator would only
+ * reach the four face neighbors with its neighborhood collectives.
+ * 
+ * comm: model communicator
+ *
+ * returns: -
+ */
+void HaloExchange::buildGraph(MPI_Comm comm){
+	int size;
+	MPI_Comm_size(comm, &size);
+	int cols = startX.size();
+	int rows = startY.size();
+
+	neighbors.clear();
+	neighborIndex.assign(size, -1);
+	for (int dx=-1; dx<=1; dx++){
+		for (int dy=-1; dy<=1; dy++){
+			int r = rankAt[((row[rank] + dy + rows) % rows) * cols + (column[rank] + dx + cols) % cols];
+			if (r == rank || neighborIndex[r] >= 0) continue;
+			neighborIndex[r] = neighbors.size();
+			neighbors.push_back(r);
+		}
+	}
+
+	MPI_Dist_graph_create_adjacent(comm, neighbors.size(), neighbors.data(), MPI_UNWEIGHTED,
+	                               neighbors.size(), neighbors.data(), MPI_UNWEIGHTED, MPI_INFO_NULL, 0, &graph);
+
+	exported.assign(neighbors.size(), std::vector<HaloExport>());
+	exporting.resize(neighbors.size());
+	out.resize(neighbors.size());
+	moved.resize(neighbors.size());
+	sendCounts.resize(neighbors.size());
+	sendDispls.resize(neighbors.size());
+	recvCounts.resize(neighbors.size());
+	recvDispls.resize(neighbors.size());
+	sendSizes.resize(2 * neighbors.size());
+	recvSizes.resize(2 * neighbors.size());
+	slotTo.assign(neighbors.size(), nullptr);
+	slotFrom.assign(neighbors.size(), nullptr);
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: setInterest
+ * --------------------
+ * Turn on interest management. The ghost frame of a process, its bounds
+ * widened by the buffer, is split in square cells; a cell is of interest if
+ * it is within the play radius of an agent of the process.
+ * 
+ * _radius: play radius
+ * cellSize: side of the cells
+ *
+ * returns: -
+ */
+void HaloExchange::setInterest(int _radius, int cellSize){
+	interest     = true;
+	radius       = _radius;
+	interestCell = std::max(cellSize, 1);
+	frameCellsX  = (extentX + 2 * buffer + interestCell - 1) / interestCell;
+	frameCellsY  = (extentY + 2 * buffer + interestCell - 1) / interestCell;
+	interestBits.resize((frameCellsX * frameCellsY + 7) / 8);
+
+	int total = 0;
+	interestCounts.resize(neighbors.size());
+	interestDispls.resize(neighbors.size());
+	for (size_t i=0; i<neighbors.size(); i++){
+		int cx = (columnExtent(column[neighbors[i]]) + 2 * buffer + interestCell - 1) / interestCell;
+		int cy = (rowExtent(row[neighbors[i]]) + 2 * buffer + interestCell - 1) / interestCell;
+		interestCounts[i] = (cx * cy + 7) / 8;
+		interestDispls[i] = total;
+		total += interestCounts[i];
+	}
+	neighborInterest.resize(std::max(total, 1));
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: setSharedTransport
+ * --------------------
+ * Turn on the shared memory transport, collective. Neighbors on the same
+ * node are found through MPI_Comm_split_type; every process allocates, in a
+ * window shared with its node, two slots (even and odd exchanges) for each of
+ * them. A slot is written by this process and read by the neighbor once the
+ * message sizes are exchanged, which also tells the writer that the slot of
+ * the exchange before is no longer read.
+ * 
+ * _slotSize: bytes of a slot, larger messages are sent
+ *
+ * returns: -
+ */
+void HaloExchange::setSharedTransport(size_t _slotSize){
+	size_t n = neighbors.size();
+	slotSize = _slotSize;
+
+	MPI_Comm_split_type(world, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+	MPI_Group worldGroup, nodeGroup;
+	MPI_Comm_group(world, &worldGroup);
+	MPI_Comm_group(node, &nodeGroup);
+	std::vector<int> nodeRank(n);
+	MPI_Group_translate_ranks(worldGroup, n, neighbors.data(), nodeGroup, nodeRank.data());
+	MPI_Group_free(&worldGroup);
+	MPI_Group_free(&nodeGroup);
+
+	std::vector<int> slotIndex(n, -1), peerSlot(n, -1);
+	int slots = 0;
+	for (size_t i=0; i<n; i++)
+		if (nodeRank[i] != MPI_UNDEFINED) slotIndex[i] = slots++;
+
+	MPI_Info info;
+	MPI_Info_create(&info);
+	MPI_Info_set(info, "alloc_shared_noncontig", "true");
+	char* base;
+	MPI_Win_allocate_shared((MPI_Aint)slots * 2 * slotSize, 1, info, node, &base, &window);
+	MPI_Info_free(&info);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+
+	// Every neighbor tells which of its slots are for this process
+	if (n > 0) MPI_Neighbor_alltoall(slotIndex.data(), 1, MPI_INT, peerSlot.data(), 1, MPI_INT, graph);
+	for (size_t i=0; i<n; i++){
+		if (slotIndex[i] < 0) continue;
+		MPI_Aint bytes;
+		int unit;
+		char* peerBase;
+		MPI_Win_shared_query(window, nodeRank[i], &bytes, &unit, &peerBase);
+		slotTo[i]   = base + (size_t)slotIndex[i] * 2 * slotSize;
+		slotFrom[i] = peerBase + (size_t)peerSlot[i] * 2 * slotSize;
+	}
+	shared = true;
+}
+/*
+ *    Class: HaloExchange  
+ * Function: owner
+ * --------------------
+ * Process owning a location
+ * 
+ * x,y: location inside the space
+ *
+ * returns: rank
+ */
+int HaloExchange::owner(int x, int y){
+	int cx = std::upper_bound(startX.begin(), startX.end(), x) - startX.begin() - 1;
+	int cy = std::upper_bound(startY.begin(), startY.end(), y) - startY.begin() - 1;
+	return rankAt[std::max(cy, 0) * startX.size() + std::max(cx, 0)];
+}
+
+
+/*
+ *    Class: HaloExchange  
+ * Function: ghostTargets
+ * --------------------
+ * Processes whose ghost area holds a location, as seen from the process
+ * owning it: the neighbors of every direction in which the location is
+ * closer than buffer to the edge of the owner bounds
+ * 
+ * owner: rank owning the location
+ * x,y: location inside the bounds of owner
+ * targets: ranks, room for 8
+ *
+ * returns: number of ranks
+ */
+int HaloExchange::ghostTargets(int owner, int x, int y, int* targets){
+	int cols = startX.size();
+	int rows = startY.size();
+	int c = column[owner];
+	int r = row[owner];
+	bool lowX  = (x <  columnOrigin(c) + buffer);
+	bool highX = (x >= columnOrigin(c) + columnExtent(c) - buffer);
+	bool lowY  = (y <  rowOrigin(r) + buffer);
+	bool highY = (y >= rowOrigin(r) + rowExtent(r) - buffer);
+	int numTargets = 0;
+
+	for (int dx=-1; dx<=1; dx++){
+		if ((dx < 0 && !lowX) || (dx > 0 && !highX)) continue;
+		for (int dy=-1; dy<=1; dy++){
+			if ((dy < 0 && !lowY) || (dy > 0 && !highY)) continue;
+			int t = rankAt[((r + dy + rows) % rows) * cols + (c + dx + cols) % cols];
+			if (t == owner || std::find(targets, targets + numTargets, t) != targets + numTargets) continue;
+			targets[numTargets++] = t;
+		}
+	}
+	return numTargets;
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: markInterest
+ * --------------------
+ * Mark the cells of the ghost frame within the play radius of a local agent,
+ * a cell counts if its closest point is. Agents whose disk stays inside the
+ * local bounds mark nothing.
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void HaloExchange::markInterest(){
+	int frameX = originX - buffer;
+	int frameY = originY - buffer;
+	std::fill(interestBits.begin(), interestBits.end(), 0);
+
+	for (size_t a=0; a<locals.size(); a++){
+		int x = agentLoc[2*a];
+		int y = agentLoc[2*a + 1];
+		if (interior(x, y, radius)) continue;
+
+		int cx0 = std::max((x - radius - frameX) / interestCell, 0);
+		int cx1 = std::min((x + radius - frameX) / interestCell, frameCellsX - 1);
+		int cy0 = std::max((y - radius - frameY) / interestCell, 0);
+		int cy1 = std::min((y + radius - frameY) / interestCell, frameCellsY - 1);
+		for (int cy=cy0; cy<=cy1; cy++){
+			int lo = frameY + cy * interestCell;
+			int dy = std::max(std::max(lo - y, y - (lo + interestCell - 1)), 0);
+			for (int cx=cx0; cx<=cx1; cx++){
+				int lx = frameX + cx * interestCell;
+				int dx = std::max(std::max(lx - x, x - (lx + interestCell - 1)), 0);
+				if (dx*dx + dy*dy > radius*radius) continue;
+				int bit = cy * frameCellsX + cx;
+				interestBits[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+			}
+		}
+	}
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: interesting
+ * --------------------
+ * Check a location against the interest received from a neighbor
+ * 
+ * i: neighbor index
+ * x,y: location
+ *
+ * returns: true if an agent of the neighbor may play with an agent there
+ */
+bool HaloExchange::interesting(int i, int x, int y){
+	int c = column[neighbors[i]];
+	int r = row[neighbors[i]];
+	int fx = ((x - (columnOrigin(c) - buffer)) % width + width) % width;
+	int fy = ((y - (rowOrigin(r) - buffer)) % height + height) % height;
+	if (fx >= columnExtent(c) + 2 * buffer || fy >= rowExtent(r) + 2 * buffer) return false;
+
+	int cellsX = (columnExtent(c) + 2 * buffer + interestCell - 1) / interestCell;
+	int bit = (fy / interestCell) * cellsX + fx / interestCell;
+	return neighborInterest[interestDispls[i] + (bit >> 3)] & (1 << (bit & 7));
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: listLocals
+ * --------------------
+ * List the local agents of the context
+ * 
+ * context: Repast context
+ *
+ * returns: -
+ */
+void HaloExchange::listLocals(repast::SharedContext<RepastHPCAgent>* context){
+	locals.clear();
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iter    = context->localBegin();
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iterEnd = context->localEnd();
+	while (iter != iterEnd){
+		locals.push_back(*iter);
+		iter++;
+	}
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: putRecord
+ * --------------------
+ * Append a record to a message
+ * 
+ * dst: message
+ * kind: HaloRecordKind
+ * id: agent id
+ * x,y: agent location
+ * agent: agent giving the counters, nullptr for a removal
+ * owner: rank owning the agent once the exchange is applied
+ *
+ * returns: -
+ */
+void HaloExchange::putRecord(std::vector<char>& dst, int kind, const repast::AgentId& id, int x, int y, RepastHPCAgent* agent, int owner){
+	HaloRecord record;
+	record.kind        = kind;
+	record.id          = id.id();
+	record.rank        = id.startingRank();
+	record.type        = id.agentType();
+	record.currentRank = owner;
+	record.x           = x;
+	record.y           = y;
+	record.pad         = 0;
+	record.c           = (agent ? agent->getC() : 0);
+	record.total       = (agent ? agent->getTotal() : 0);
+
+	size_t at = dst.size();
+	dst.resize(at + sizeof(HaloRecord));
+	memcpy(&dst[at], &record, sizeof(HaloRecord));
+	// A ghost update stands for the state package of the Repast exchanges
+	if (kind == HALO_GHOST_UPDATE) CommMetrics::packagesSent(1);
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: putPackage
+ * --------------------
+ * Append the package of an agent to a message
+ * 
+ * dst: message
+ * agent: agent
+ * currentRank: process owning the agent once received
+ *
+ * returns: -
+ */
+void HaloExchange::putPackage(std::vector<char>& dst, RepastHPCAgent* agent, int currentRank){
+	agent->getPackage(package);
+	package.currentRank = currentRank;
+
+	size_t at = dst.size();
+	dst.resize(at + package.wireSize());
+	package.pack(&dst[at]);
+	CommMetrics::packagesSent(1);
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: putGhosts
+ * --------------------
+ * Compare the ghosts to send to a neighbor with the ones sent last time and
+ * write removals, migrations and new or updated ghosts to its message. Agents
+ * of the old list may no longer exist. Ghosts sent on behalf of a new owner
+ * are forgotten, the new owner keeps track of them.
+ * 
+ * i: neighbor index
+ *
+ * returns: -
+ */
+void HaloExchange::putGhosts(size_t i){
+	std::vector<HaloExport>& now    = exporting[i];
+	std::vector<HaloExport>& before = exported[i];
+	std::sort(now.begin(), now.end());
+
+	size_t j = 0;
+	for (size_t k=0; k<before.size(); k++){
+		while (j < now.size() && now[j] < before[k]) j++;
+		if (j == now.size() || before[k] < now[j])
+			putRecord(out[i], HALO_REMOVE, before[k].id, before[k].x, before[k].y, nullptr, rank);
+	}
+
+	out[i].insert(out[i].end(), moved[i].begin(), moved[i].end());
+
+	j = 0;
+	size_t kept = 0;
+	for (size_t k=0; k<now.size(); k++){
+		while (j < before.size() && before[j] < now[k]) j++;
+		if (j == before.size() || now[k] < before[j]){
+			putRecord(out[i], HALO_GHOST_NEW, now[k].id, now[k].x, now[k].y, now[k].agent, now[k].owner);
+			putPackage(out[i], now[k].agent, now[k].owner);
+		} else {
+			putRecord(out[i], HALO_GHOST_UPDATE, now[k].id, now[k].x, now[k].y, now[k].agent, now[k].owner);
+		}
+		if (now[k].owner == rank) now[kept++] = now[k];
+	}
+	now.resize(kept);
+
+	before.swap(now);
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: putMigration
+ * --------------------
+ * Pack a local agent for its new owner. Without interest management it is
+ * also ghosted on behalf of the new owner to the processes whose ghost area
+ * holds it; if this one is among them the agent stays as a ghost, otherwise
+ * it leaves the context once the messages are written.
+ * 
+ * agent: agent
+ * x,y: agent location
+ * o: new owner
+ *
+ * returns: -
+ */
+void HaloExchange::putMigration(RepastHPCAgent* agent, int x, int y, int o){
+	repast::AgentId id = agent->getId();
+	int to = neighborIndex[o];
+	if (to < 0) throw std::runtime_error("HaloExchange: agent moved beyond the neighbor processes");
+	putRecord(moved[to], HALO_MIGRATE, id, x, y, agent, o);
+	putPackage(moved[to], agent, o);
+	agent->set(o, agent->getC(), agent->getTotal());	// no longer local
+	if (interest){
+		leaving.push_back(id);
+		return;
+	}
+
+	bool keep = false;
+	int targets[8];
+	int numTargets = ghostTargets(o, x, y, targets);
+	for (int t=0; t<numTargets; t++){
+		if (targets[t] == rank){
+			keep = true;
+			continue;
+		}
+		int i = neighborIndex[targets[t]];
+		if (i < 0) throw std::runtime_error("HaloExchange: ghost area beyond the neighbor processes");
+		HaloExport e = {id, agent, x, y, o};
+		exporting[i].push_back(e);
+	}
+	if (!keep) leaving.push_back(id);	// otherwise stays as a ghost of the new owner
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: flatten
+ * --------------------
+ * Copy the messages in out to the slots of the neighbors on the node, those
+ * that fit, and the rest, encoded by the codec if any, one after the other
+ * into the send buffer. Sizes to exchange are the bytes sent and the bytes in
+ * the slot of every neighbor.
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void HaloExchange::flatten(){
+	size_t total = 0;
+	for (size_t i=0; i<neighbors.size(); i++){
+		size_t bytes = out[i].size();
+		bool inSlot = (slotTo[i] != nullptr && bytes <= slotSize);
+		if (inSlot && bytes) memcpy(slotTo[i] + (generation & 1) * slotSize, out[i].data(), bytes);
+		if (!inSlot && bytes && codec){
+			codec->encode(out[i].data(), bytes, encoded);
+			out[i].swap(encoded);
+			bytes = out[i].size();
+		}
+		sendSizes[2*i]     = (inSlot ? 0 : bytes);
+		sendSizes[2*i + 1] = (inSlot ? bytes : 0);
+		sendCounts[i] = sendSizes[2*i];
+		sendDispls[i] = total;
+		total += sendCounts[i];
+	}
+	sendBuffer.resize(std::max(total, (size_t)1));
+	for (size_t i=0; i<neighbors.size(); i++)
+		if (sendCounts[i]) memcpy(&sendBuffer[sendDispls[i]], out[i].data(), sendCounts[i]);
+	if (shared) MPI_Win_sync(window);
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: send
+ * --------------------
+ * Blocking exchange of the messages in out: sizes, then messages
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void HaloExchange::send(){
+	flatten();
+	MPI_Ineighbor_alltoall(sendSizes.data(), 2, MPI_INT, recvSizes.data(), 2, MPI_INT, graph, &request);
+	stage = 1;
+	progress();
+	MPI_Wait(&request, MPI_STATUS_IGNORE);
+	stage = 0;
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: exchange
+ * --------------------
+ * Synchronize the tick with the neighbors, blocking
+ * 
+ * context: Repast context
+ * space: Repast space
+ * receiver: creates migrated agents
+ * ghostReceiver: creates ghost agents
+ * departures: if not null, the only local agents out of the local bounds
+ *
+ * returns: -
+ */
+void HaloExchange::exchange(repast::SharedContext<RepastHPCAgent>* context,
+                            repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+                            RepastHPCAgentPackageReceiver* receiver, RepastHPCAgentPackageReceiver* ghostReceiver,
+                            const std::vector<HaloDeparture>* departures){
+	post(context, space, receiver, ghostReceiver, departures);
+	complete(context, space, receiver, ghostReceiver);
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: post
+ * --------------------
+ * Start the synchronization of the tick with the neighbors. Local agents out
+ * of the local bounds migrate to their owner, and are ghosted on its behalf
+ * to the processes whose ghost area holds them, this one included; the rest
+ * are exported as ghosts to the neighbors whose ghost area holds them. Every
+ * message carries, in order, removals of the ghosts no longer sent,
+ * migrations, new ghosts and updates of known ghosts. Message sizes leave
+ * through a nonblocking neighborhood collective.
+ *
+ * With interest management migrations, along with the removal of their
+ * ghosts, are exchanged and applied first, then the interest of every
+ * process, and only then the ghosts are chosen among the local agents.
+ *
+ * Given the departures of the move phase, emigrants are packed from them and
+ * the local agents are only walked for ghosts (not at all in the first
+ * round with interest management), migration takes time with the crossings
+ * instead of with the local agents.
+ * 
+ * context: Repast context
+ * space: Repast space
+ * receiver: creates migrated agents
+ * ghostReceiver: creates ghost agents
+ * departures: if not null, the only local agents out of the local bounds
+ *
+ * returns: -
+ */
+void HaloExchange::post(repast::SharedContext<RepastHPCAgent>* context,
+                        repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+                        RepastHPCAgentPackageReceiver* receiver, RepastHPCAgentPackageReceiver* ghostReceiver,
+                        const std::vector<HaloDeparture>* departures){
+	size_t n = neighbors.size();
+	if (n == 0) return;
+
+	for (size_t i=0; i<n; i++){
+		out[i].clear();
+		moved[i].clear();
+		exporting[i].clear();
+	}
+	leaving.clear();
+
+	// Emigrants get the rank of their new owner, out of the local agents listed next
+	if (departures)
+		for (size_t d=0; d<departures->size(); d++){
+			const HaloDeparture& departure = (*departures)[d];
+			int o = owner(departure.x, departure.y);
+			if (o != rank) putMigration(departure.agent, departure.x, departure.y, o);
+		}
+
+	int targets[8];
+	if (!departures || !interest){
+		listLocals(context);
+		for (size_t a=0; a<locals.size(); a++){
+			RepastHPCAgent* agent = locals[a];
+			location.clear();
+			space->getLocation(agent->getId(), location);
+			int x = location[0];
+			int y = location[1];
+
+			int o = (departures ? rank : owner(x, y));
+			if (o != rank){
+				putMigration(agent, x, y, o);
+				continue;
+			}
+			if (interest) continue;
+
+			int numTargets = ghostTargets(rank, x, y, targets);
+			for (int t=0; t<numTargets; t++){
+				HaloExport e = {agent->getId(), agent, x, y, rank};
+				exporting[neighborIndex[targets[t]]].push_back(e);
+			}
+		}
+	}
+
+	if (interest){
+		// Round 1: migrations, their ghosts are removed before the new owner sends them again
+		std::sort(leaving.begin(), leaving.end());
+		for (size_t i=0; i<n; i++){
+			size_t kept = 0;
+			for (size_t k=0; k<exported[i].size(); k++){
+				if (std::binary_search(leaving.begin(), leaving.end(), exported[i][k].id))
+					putRecord(out[i], HALO_REMOVE, exported[i][k].id, exported[i][k].x, exported[i][k].y, nullptr, rank);
+				else
+					exported[i][kept++] = exported[i][k];
+			}
+			exported[i].resize(kept);
+			out[i].insert(out[i].end(), moved[i].begin(), moved[i].end());
+			moved[i].clear();
+		}
+		for (size_t k=0; k<leaving.size(); k++)
+			context->removeAgent(leaving[k]);
+		send();
+		apply(context, space, receiver, ghostReceiver, nullptr);
+
+		// Round 2: interest, the same bitmap to every neighbor
+		listLocals(context);
+		agentLoc.resize(2 * locals.size());
+		for (size_t a=0; a<locals.size(); a++){
+			location.clear();
+			space->getLocation(locals[a]->getId(), location);
+			agentLoc[2*a]     = location[0];
+			agentLoc[2*a + 1] = location[1];
+		}
+		markInterest();
+		MPI_Neighbor_allgatherv(interestBits.data(), interestBits.size(), MPI_BYTE,
+		                        neighborInterest.data(), interestCounts.data(), interestDispls.data(), MPI_BYTE, graph);
+
+		// Round 3: ghosts of interest to each neighbor
+		for (size_t a=0; a<locals.size(); a++){
+			int x = agentLoc[2*a];
+			int y = agentLoc[2*a + 1];
+			int numTargets = ghostTargets(rank, x, y, targets);
+			for (int t=0; t<numTargets; t++){
+				int i = neighborIndex[targets[t]];
+				if (!interesting(i, x, y)) continue;
+				HaloExport e = {locals[a]->getId(), locals[a], x, y, rank};
+				exporting[i].push_back(e);
+			}
+		}
+		for (size_t i=0; i<n; i++){
+			out[i].clear();
+			putGhosts(i);
+		}
+	} else {
+		for (size_t i=0; i<n; i++)
+			putGhosts(i);
+		for (size_t k=0; k<leaving.size(); k++)
+			context->removeAgent(leaving[k]);
+	}
+
+	flatten();
+	MPI_Ineighbor_alltoall(sendSizes.data(), 2, MPI_INT, recvSizes.data(), 2, MPI_INT, graph, &request);
+	stage = 1;
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: progress
+ * --------------------
+ * Wait for the message sizes and start the nonblocking exchange of the
+ * messages, nothing to do if already started
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void HaloExchange::progress(){
+	if (stage != 1) return;
+	MPI_Wait(&request, MPI_STATUS_IGNORE);
+	if (shared) MPI_Win_sync(window);
+
+	size_t total = 0;
+	for (size_t i=0; i<neighbors.size(); i++){
+		recvCounts[i] = recvSizes[2*i];
+		recvDispls[i] = total;
+		total += recvCounts[i];
+	}
+	recvBuffer.resize(std::max(total, (size_t)1));
+	MPI_Ineighbor_alltoallv(sendBuffer.data(), sendCounts.data(), sendDispls.data(), MPI_BYTE,
+	                        recvBuffer.data(), recvCounts.data(), recvDispls.data(), MPI_BYTE, graph, &request);
+	stage = 2;
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: complete
+ * --------------------
+ * Finish the synchronization started by post and apply the received records
+ * 
+ * context: Repast context
+ * space: Repast space
+ * receiver: creates migrated agents
+ * ghostReceiver: creates ghost agents
+ * arrivals: if not null, migrated agents are appended to it
+ *
+ * returns: -
+ */
+void HaloExchange::complete(repast::SharedContext<RepastHPCAgent>* context,
+                            repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+                            RepastHPCAgentPackageReceiver* receiver, RepastHPCAgentPackageReceiver* ghostReceiver,
+                            std::vector<RepastHPCAgent*>* arrivals){
+	if (stage == 0) return;
+	progress();
+	MPI_Wait(&request, MPI_STATUS_IGNORE);
+	stage = 0;
+
+	apply(context, space, receiver, ghostReceiver, arrivals);
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: apply
+ * --------------------
+ * Apply the received records to the context and the space. Without interest
+ * management the ghosts of a migrated agent were sent by its former owner, it
+ * is added to the lists of ghosts sent to the neighbors to take them over.
+ * 
+ * context: Repast context
+ * space: Repast space
+ * receiver: creates migrated agents
+ * ghostReceiver: creates ghost agents
+ * arrivals: if not null, migrated agents are appended to it
+ *
+ * returns: -
+ */
+void HaloExchange::apply(repast::SharedContext<RepastHPCAgent>* context,
+                         repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+                         RepastHPCAgentPackageReceiver* receiver, RepastHPCAgentPackageReceiver* ghostReceiver,
+                         std::vector<RepastHPCAgent*>* arrivals){
+	size_t n = neighbors.size();
+	bool takenOver = false;
+	int targets[8];
+	location.resize(2);
+
+	for (size_t i=0; i<n; i++){
+		// A message left in the slot of the neighbor is parsed in place
+		const char* p   = (recvSizes[2*i + 1] > 0 ? slotFrom[i] + (generation & 1) * slotSize : &recvBuffer[recvDispls[i]]);
+		size_t bytes    = (recvSizes[2*i + 1] > 0 ? recvSizes[2*i + 1] : recvCounts[i]);
+		if (recvSizes[2*i + 1] == 0 && bytes && codec) p = codec->decode(p, bytes, decoded, &bytes);
+		const char* end = p + bytes;
+		while (p < end){
+			HaloRecord record;
+			memcpy(&record, p, sizeof(HaloRecord));
+			p += sizeof(HaloRecord);
+			repast::AgentId id(record.id, record.rank, record.type);
+			location[0] = record.x;
+			location[1] = record.y;
+
+			switch (record.kind){
+			case HALO_REMOVE:
+				if (context->contains(id) && context->getAgent(id)->getId().currentRank() != rank)
+					context->removeAgent(id);
+				break;
+			case HALO_MIGRATE: {
+				p = package.unpack(p);
+				package.currentRank = rank;
+				if (context->contains(id)) context->removeAgent(id);
+				RepastHPCAgent* agent = receiver->createAgent(package);
+				context->addAgent(agent);
+				space->moveTo(agent->getId(), location);
+				if (arrivals) arrivals->push_back(agent);
+				if (interest) break;
+
+				int numTargets = ghostTargets(rank, record.x, record.y, targets);
+				for (int t=0; t<numTargets; t++){
+					HaloExport e = {agent->getId(), agent, record.x, record.y, rank};
+					exported[neighborIndex[targets[t]]].push_back(e);
+				}
+				takenOver = true;
+				break;
+			}
+			case HALO_GHOST_NEW: {
+				p = package.unpack(p);
+				if (context->contains(id)) context->removeAgent(id);
+				RepastHPCAgent* agent = ghostReceiver->createAgent(package);
+				context->addAgent(agent);
+				space->moveTo(agent->getId(), location);
+				break;
+			}
+			case HALO_GHOST_UPDATE: {
+				if (!context->contains(id)){
+					std::ostringstream message;
+					message << "HaloExchange: update of the unknown ghost " << id << " from rank " << neighbors[i];
+					throw std::runtime_error(message.str());
+				}
+				RepastHPCAgent* agent = context->getAgent(id);
+				agent->set(record.currentRank, record.c, record.total);
+				space->moveTo(agent->getId(), location);
+				CommMetrics::packagesReceived(1);
+				break;
+			}
+			}
+		}
+	}
+
+	if (takenOver)
+		for (size_t i=0; i<n; i++)
+			std::sort(exported[i].begin(), exported[i].end());
+	generation++;
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: placeCuts
+ * --------------------
+ * Place the boundaries between the processes along an axis so that every
+ * process gets the same share of the load histogram, each process at least
+ * minExtent wide so that ghost areas only reach adjacent processes
+ * 
+ * hist: load of every coordinate of the axis
+ * minExtent: smallest width of a process
+ * start: first coordinate of every process, start[0] stays
+ *
+ * returns: true if the boundaries moved
+ */
+bool HaloExchange::placeCuts(const std::vector<double>& hist, int minExtent, std::vector<int>& start){
+	int parts = start.size();
+	int length = hist.size();
+	if (parts < 2 || length < parts * minExtent) return false;
+
+	double total = 0;
+	for (int v=0; v<length; v++) total += hist[v];
+	if (total <= 0) return false;
+
+	std::vector<int> cut(parts);
+	cut[0] = 0;
+	double acc = 0;
+	int p = 1;
+	for (int v=0; v<length && p<parts; v++){
+		acc += hist[v];
+		while (p < parts && acc >= total * p / parts) cut[p++] = v + 1;
+	}
+	for (; p<parts; p++) cut[p] = length;
+
+	for (p=1; p<parts; p++) cut[p] = std::max(cut[p], cut[p-1] + minExtent);
+	cut[parts-1] = std::min(cut[parts-1], length - minExtent);
+	for (p=parts-2; p>0; p--) cut[p] = std::min(cut[p], cut[p+1] - minExtent);
+
+	bool changed = false;
+	for (p=1; p<parts; p++){
+		changed |= (start[p] != start[0] + cut[p]);
+		start[p] = start[0] + cut[p];
+	}
+	return changed;
+}
+
+/*
+ *    Class: HaloExchange  
+ * Function: rebalance
+ * --------------------
+ * Move the boundaries between process columns and between process rows so
+ * that every column and every row carries the same load, measured by the
+ * global histograms along x and y of the local agents weighted by their cost.
+ * When the boundaries move, ghosts are dropped (the next exchange sends them
+ * all again) and local agents out of the new bounds migrate in bulk to their
+ * new owner, whatever the distance, through one all to all exchange.
+ * 
+ * context: Repast context
+ * space: Repast space
+ * receiver: creates migrated agents
+ * cost: time spent on the local agents since the last rebalance, 0 to balance agent counts
+ *
+ * returns: true if the bounds changed
+ */
+bool HaloExchange::rebalance(repast::SharedContext<RepastHPCAgent>* context,
+                             repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >* space,
+                             RepastHPCAgentPackageReceiver* receiver, double cost){
+	int size;
+	MPI_Comm_size(world, &size);
+
+	listLocals(context);
+	double weight = (cost > 0 && locals.size() > 0 ? cost / locals.size() : 1);
+	histX.assign(width, 0);
+	histY.assign(height, 0);
+	agentLoc.resize(2 * locals.size());
+	for (size_t a=0; a<locals.size(); a++){
+		location.clear();
+		space->getLocation(locals[a]->getId(), location);
+		agentLoc[2*a]     = location[0];
+		agentLoc[2*a + 1] = location[1];
+		histX[location[0] - startX[0]] += weight;
+		histY[location[1] - startY[0]] += weight;
+	}
+	MPI_Allreduce(MPI_IN_PLACE, histX.data(), width, MPI_DOUBLE, MPI_SUM, world);
+	MPI_Allreduce(MPI_IN_PLACE, histY.data(), height, MPI_DOUBLE, MPI_SUM, world);
+
+	bool movedX = placeCuts(histX, buffer + 1, startX);
+	bool movedY = placeCuts(histY, buffer + 1, startY);
+	if (!movedX && !movedY) return false;
+
+	originX = columnOrigin(column[rank]);
+	originY = rowOrigin(row[rank]);
+	extentX = columnExtent(column[rank]);
+	extentY = rowExtent(row[rank]);
+	if (interest) setInterest(radius, interestCell);
+
+	// Ghosts of the old layout
+	std::vector<repast::AgentId> ghosts;
+	repast::SharedContext<RepastHPCAgent>::const_iterator iter    = context->begin();
+	repast::SharedContext<RepastHPCAgent>::const_iterator iterEnd = context->end();
+	while (iter != iterEnd){
+		if ((*iter)->getId().currentRank() != rank) ghosts.push_back((*iter)->getId());
+		iter++;
+	}
+	for (size_t k=0; k<ghosts.size(); k++)
+		context->removeAgent(ghosts[k]);
+	for (size_t i=0; i<neighbors.size(); i++)
+		exported[i].clear();
+
+	// Bulk migration
+	bulk.resize(size);
+	bulkCounts.resize(size);
+	bulkDispls.resize(size);
+	bulkRecvCounts.resize(size);
+	bulkRecvDispls.resize(size);
+	for (int r=0; r<size; r++)
+		bulk[r].clear();
+	leaving.clear();
+	for (size_t a=0; a<locals.size(); a++){
+		int x = agentLoc[2*a];
+		int y = agentLoc[2*a + 1];
+		int o = owner(x, y);
+		if (o == rank) continue;
+		putRecord(bulk[o], HALO_MIGRATE, locals[a]->getId(), x, y, locals[a], o);
+		putPackage(bulk[o], locals[a], o);
+		leaving.push_back(locals[a]->getId());
+	}
+	for (size_t k=0; k<leaving.size(); k++)
+		context->removeAgent(leaving[k]);
+
+	size_t total = 0;
+	for (int r=0; r<size; r++){
+		bulkCounts[r] = bulk[r].size();
+		bulkDispls[r] = total;
+		total += bulk[r].size();
+	}
+	sendBuffer.resize(std::max(total, (size_t)1));
+	for (int r=0; r<size; r++)
+		if (bulkCounts[r]) memcpy(&sendBuffer[bulkDispls[r]], bulk[r].data(), bulkCounts[r]);
+
+	MPI_Alltoall(bulkCounts.data(), 1, MPI_INT, bulkRecvCounts.data(), 1, MPI_INT, world);
+	total = 0;
+	for (int r=0; r<size; r++){
+		bulkRecvDispls[r] = total;
+		total += bulkRecvCounts[r];
+	}
+	recvBuffer.resize(std::max(total, (size_t)1));
+	MPI_Alltoallv(sendBuffer.data(), bulkCounts.data(), bulkDispls.data(), MPI_BYTE,
+	              recvBuffer.data(), bulkRecvCounts.data(), bulkRecvDispls.data(), MPI_BYTE, world);
+
+	location.resize(2);
+	const char* p   = recvBuffer.data();
+	const char* end = p + total;
+	while (p < end){
+		HaloRecord record;
+		memcpy(&record, p, sizeof(HaloRecord));
+		p = package.unpack(p + sizeof(HaloRecord));
+		package.currentRank = rank;
+		RepastHPCAgent* agent = receiver->createAgent(package);
+		context->addAgent(agent);
+		location[0] = record.x;
+		location[1] = record.y;
+		space->moveTo(agent->getId(), location);
+	}
+	return true;
+}
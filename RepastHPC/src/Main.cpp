@@ -42,7 +42,7 @@ int main(int argc, char** argv){
 	std::string configFile = argv[1]; // The name of the configuration file is Arg 1
 	std::string propsFile  = argv[2]; // The name of the properties file is Arg 2
 	
-	boost::mpi::environment env(argc, argv);
+	boost::mpi::environment env(argc, argv, boost::mpi::threading::funneled); // Only the main thread of the pool calls MPI
 	boost::mpi::communicator world;
 
 	boost::mpi::timer time;
@@ -25,8 +25,14 @@
 
 
 #include <stdio.h>
+#include <math.h>
+#include <string.h>
 #include <vector>
+#include <map>
+#include <stdexcept>
+#include <algorithm>
 #include <boost/mpi.hpp>
+#include <boost/lexical_cast.hpp>
 #include "repast_hpc/AgentId.h"
 #include "repast_hpc/RepastProcess.h"
 #include "repast_hpc/Utilities.h"
@@ -36,6 +42,9 @@
 #include "repast_hpc/Point.h"
 
 #include "Model.h"
+#include "CommMetrics.h"
+#include "TiledAgents.h"
+#include "FFTVector.h"
 
 fftw_complex	*in = nullptr;
 
@@ -56,7 +65,8 @@ RepastHPCAgentPackageProvider::RepastHPCAgentPackageProvider(repast::SharedConte
  *    Class: RepastHPCAgentPackageProvider  
  * Function: providePackage
  * --------------------
- * Builds ans agent package and puts in a vector
+ * Builds ans agent package and puts in a vector, the package is filled in
+ * place
  * 
  * agent: agent
  * out: vector of agents packaages
@@ -64,13 +74,9 @@ RepastHPCAgentPackageProvider::RepastHPCAgentPackageProvider(repast::SharedConte
  * returns: -
  */
 void RepastHPCAgentPackageProvider::providePackage(RepastHPCAgent * agent, std::vector<RepastHPCAgentPackage>& out){
-    repast::AgentId id = agent->getId();
-    
-    char newm[COM_BUFFER_SIZE];
-    agent->getm(newm);
-    
-    RepastHPCAgentPackage package(id.id(), id.startingRank(), id.agentType(), id.currentRank(), agent->getC(), agent->getTotal(), newm, agent->getN());
-    out.push_back(package);
+    out.resize(out.size() + 1);
+    agent->getPackage(out.back());
+    CommMetrics::packagesSent(1);
 }
 
 /*
@@ -91,6 +97,29 @@ void RepastHPCAgentPackageProvider::provideContent(repast::AgentRequest req, std
     }
 }
 
+/*
+ *    Class: RepastHPCAgentPackageProvider  
+ * Function: provideContent
+ * --------------------
+ * Puts the deltas of the requested agents that changed since the last ghost
+ * state exchange into a vector, unchanged agents send nothing
+ * 
+ * req: vector of agents
+ * out: vector of agent deltas
+ *
+ * returns: -
+ */
+void RepastHPCAgentPackageProvider::provideContent(repast::AgentRequest req, std::vector<RepastHPCAgentDelta>& out){
+    const std::vector<repast::AgentId>& ids = req.requestedAgents();
+    for(size_t i = 0; i < ids.size(); i++){
+        RepastHPCAgent* agent = agents->getAgent(ids[i]);
+        if (agent->dirtyFields() == 0) continue;
+        out.resize(out.size() + 1);
+        agent->getDelta(out.back());
+    }
+    CommMetrics::packagesSent(out.size());
+}
+
 /*
  *    Class: RepastHPCAgentPackageReceiver
  * Function: RepastHPCAgentPackageReceiver 
@@ -98,10 +127,11 @@ void RepastHPCAgentPackageProvider::provideContent(repast::AgentRequest req, std
  * RepastHPCAgentPackageReceiver constructor
  * 
  * agentPtr: agent
+ * pool: pool of the agents created by the receiver
  *
  * returns: -
  */
-RepastHPCAgentPackageReceiver::RepastHPCAgentPackageReceiver(repast::SharedContext<RepastHPCAgent>* agentPtr): agents(agentPtr){
+RepastHPCAgentPackageReceiver::RepastHPCAgentPackageReceiver(repast::SharedContext<RepastHPCAgent>* agentPtr, AgentPool* pool): agents(agentPtr), agentPool(pool){
 }
 
 /*
@@ -114,9 +144,10 @@ RepastHPCAgentPackageReceiver::RepastHPCAgentPackageReceiver(repast::SharedConte
  *
  * returns: new agent
  */
-RepastHPCAgent * RepastHPCAgentPackageReceiver::createAgent(RepastHPCAgentPackage package){
+RepastHPCAgent * RepastHPCAgentPackageReceiver::createAgent(const RepastHPCAgentPackage& package){
     repast::AgentId id(package.id, package.rank, package.type, package.currentRank);
-    return new RepastHPCAgent(id, package.c, package.total, package.m, package.N, in);
+    CommMetrics::packagesReceived(1);
+    return new (*agentPool) RepastHPCAgent(id, package.key, package.c, package.total, package.m, package.N, in);
 }
 
 /*
@@ -129,10 +160,28 @@ RepastHPCAgent * RepastHPCAgentPackageReceiver::createAgent(RepastHPCAgentPackag
  *
  * returns: new agent
  */
-void RepastHPCAgentPackageReceiver::updateAgent(RepastHPCAgentPackage package){
+void RepastHPCAgentPackageReceiver::updateAgent(const RepastHPCAgentPackage& package){
     repast::AgentId id(package.id, package.rank, package.type);
     RepastHPCAgent * agent = agents->getAgent(id);
     agent->set(package.currentRank, package.c, package.total);
+    CommMetrics::packagesReceived(1);
+}
+
+/*
+ *    Class: RepastHPCAgentPackageReceiver
+ * Function: updateAgent 
+ * --------------------
+ * Update agent with the fields of a delta
+ * 
+ * delta: agent delta
+ *
+ * returns: -
+ */
+void RepastHPCAgentPackageReceiver::updateAgent(const RepastHPCAgentDelta& delta){
+    repast::AgentId id(delta.id, delta.rank, delta.type);
+    RepastHPCAgent * agent = agents->getAgent(id);
+    agent->set(delta);
+    CommMetrics::packagesReceived(1);
 }
 
 /*
@@ -256,7 +305,7 @@ int DataSource_AgentNumber::getData(){
  *
  * returns: -
  */
-RepastHPCModel::RepastHPCModel(std::string propsFile, int argc, char** argv, boost::mpi::communicator* comm): context(comm){
+RepastHPCModel::RepastHPCModel(std::string propsFile, int argc, char** argv, boost::mpi::communicator* comm): localPool("local", sizeof(RepastHPCAgent)), ghostPool("ghost", sizeof(RepastHPCAgent)), context(comm){
 	props = new repast::Properties(propsFile, argc, argv, comm);
 	stopAt = repast::strToInt(props->getProperty("stop.at"));
 
@@ -265,25 +314,146 @@ RepastHPCModel::RepastHPCModel(std::string propsFile, int argc, char** argv, boo
 
 	initialAgentsFile = props->getProperty("initial.agents.file");
 	initialFFTVectorFile = props->getProperty("initial.fft.vector.file");
+	tiledAgents = (props->getProperty("initial.agents.format") == "tiles");
+	binaryFFTVector = (props->getProperty("initial.fft.vector.format") == "binary");
+	generatedAgents = (props->getProperty("initial.agents.format") == "generate");
+	generatedFFTVector = (props->getProperty("initial.fft.vector.format") == "generate");
+	fftVector = nullptr;
+
+	fftPlans = new FFTPlanCache(props->getProperty("fft.planner"), props->getProperty("fft.wisdom.file"));
+	fftBatched = (props->getProperty("fft.mode") == "batched");
+	fftBatchSize = (fftBatched ? repast::strToInt(props->getProperty("fft.batch.size")) : 1);
+	if (fftBatchSize < 1) fftBatchSize = 1;
+
+	threadsPerRank = (props->contains("threads.per.rank") ? repast::strToInt(props->getProperty("threads.per.rank")) : 1);
+	if (threadsPerRank < 1) threadsPerRank = 1;
+	soaStore = (props->getProperty("agent.store") == "soa");
+	cellEngine = (props->getProperty("neighbor.engine") == "cells");
+	batchRates = (props->getProperty("rates.kernel") == "batch");
+	deltaSync = (props->getProperty("ghost.sync") == "delta");
+	fusedSync = (props->getProperty("sync.engine") == "fused");
+	overlapSync = (props->getProperty("sync.overlap") == "true");
+	if (overlapSync && (!fusedSync || soaStore)){
+		if (comm->rank() == 0) std::cout << "sync.overlap needs sync.engine = fused and agent.store = object, ignored" << std::endl;
+		overlapSync = false;
+	}
+	ghostInterest = (props->getProperty("ghost.interest") == "true");
+	if (ghostInterest && !fusedSync){
+		if (comm->rank() == 0) std::cout << "ghost.interest needs sync.engine = fused, ignored" << std::endl;
+		ghostInterest = false;
+	}
+	sharedTransport = (props->getProperty("halo.transport") == "shm");
+	if (sharedTransport && !fusedSync){
+		if (comm->rank() == 0) std::cout << "halo.transport = shm needs sync.engine = fused, ignored" << std::endl;
+		sharedTransport = false;
+	}
+	std::string compression = (props->contains("halo.compression") ? props->getProperty("halo.compression") : "off");
+	if (compression != "off" && !fusedSync){
+		if (comm->rank() == 0) std::cout << "halo.compression needs sync.engine = fused, ignored" << std::endl;
+		compression = "off";
+	}
+	if (compression == "lz4" && !PayloadCodec::lz4Available()){
+		if (comm->rank() == 0) std::cout << "halo.compression = lz4 needs -DHAVE_LZ4, zero runs only" << std::endl;
+		compression = "zero";
+	}
+	codec = nullptr;
+	compressionFile = nullptr;
+	if (compression != "off"){
+		codec = new PayloadCodec(compression == "lz4", props->contains("halo.compression.min.bytes") ? repast::strToInt(props->getProperty("halo.compression.min.bytes")) : 512);
+		if (comm->rank() == 0){
+			compressionFile = fopen("./output/compression.csv", "w");
+			if (compressionFile) fprintf(compressionFile, "tick,messages,compressed,raw_bytes,wire_bytes,ratio,encode_max_ms,decode_max_ms\n");
+		}
+	}
+	checkpointEvery = (props->contains("checkpoint.every") ? repast::strToInt(props->getProperty("checkpoint.every")) : 0);
+	checkpoint = nullptr;
+	if (checkpointEvery > 0)
+		checkpoint = new Checkpoint(*comm, props->contains("checkpoint.file") ? props->getProperty("checkpoint.file") : "./output/checkpoint.bin");
+	restartFile = (props->contains("restart.file") ? props->getProperty("restart.file") : "");
+	startTick = 0;
+	balanceEvery = (props->contains("balance.every") ? repast::strToInt(props->getProperty("balance.every")) : 0);
+	if (balanceEvery > 0 && !fusedSync){
+		if (comm->rank() == 0) std::cout << "balance.every needs sync.engine = fused, ignored" << std::endl;
+		balanceEvery = 0;
+	}
+	balanceByTime = (props->getProperty("balance.weight") == "time");
+	imbalanceReport = (balanceEvery > 0 || props->getProperty("balance.report") == "true");
+	workSinceBalance = 0;
+	imbalanceFile = nullptr;
+	if (imbalanceReport && comm->rank() == 0){
+		imbalanceFile = fopen("./output/imbalance.csv", "w");
+		if (imbalanceFile) fprintf(imbalanceFile, "tick,agents_max,agents_mean,agents_imbalance,work_max_ms,work_mean_ms,work_imbalance\n");
+	}
+	params.read(props);
+	RepastHPCAgent::setParameters(params);
+	bool specialized;
+	playKernel = RepastHPCAgent::playKernel(params.radius, params.maxAgentsToPlay, &specialized);
+	int cellSize = (props->contains("neighbor.cell.size") ? repast::strToInt(props->getProperty("neighbor.cell.size")) : params.radius / 2);
+
+	profiler = new Profiler();
+	profiler->label("initial.agents.format", tiledAgents ? "tiles" : (generatedAgents ? "generate" : "text"));
+	profiler->label("initial.fft.vector.format", binaryFFTVector ? "binary" : (generatedFFTVector ? "generate" : "text"));
+	profiler->label("fft.mode", fftBatched ? "batched" : "agent");
+	profiler->label("fft.batch.size", boost::lexical_cast<std::string>(fftBatchSize));
+	profiler->label("procs", boost::lexical_cast<std::string>(comm->size()));
+	profiler->label("threads.per.rank", boost::lexical_cast<std::string>(threadsPerRank));
+	profiler->label("agent.store", soaStore ? "soa" : "object");
+	profiler->label("neighbor.engine", cellEngine ? "cells" : "repast");
+	profiler->label("rates.kernel", batchRates ? "batch" : "agent");
+	profiler->label("ghost.sync", deltaSync ? "delta" : "full");
+	profiler->label("sync.engine", fusedSync ? "fused" : "repast");
+	profiler->label("sync.overlap", overlapSync ? "true" : "false");
+	profiler->label("ghost.interest", ghostInterest ? "true" : "false");
+	profiler->label("halo.transport", sharedTransport ? "shm" : "mpi");
+	profiler->label("halo.compression", compression);
+	profiler->label("checkpoint.every", boost::lexical_cast<std::string>(checkpointEvery));
+	profiler->label("restart", restartFile.empty() ? "false" : "true");
+	profiler->label("balance.every", boost::lexical_cast<std::string>(balanceEvery));
+	profiler->label("balance.weight", balanceByTime ? "time" : "agents");
+	if (props->getProperty("comm.metrics") == "true") CommMetrics::enable(*comm);
+	profiler->label("comm.metrics", CommMetrics::enabled() ? "true" : "false");
+	profiler->label("model.radius", boost::lexical_cast<std::string>(params.radius));
+	profiler->label("model.max.agents.to.play", boost::lexical_cast<std::string>(params.maxAgentsToPlay));
+	profiler->label("model.com.buffer.size", boost::lexical_cast<std::string>(params.comBufferSize));
+	profiler->label("play.kernel", specialized ? "specialized" : "generic");
 	
 	initializeRandom(*props, comm);
+
+	pool = new ThreadPool(threadsPerRank);
+	table = new AgentTable();
+	cells = new CellGrid(params.radius, cellSize);
+	rates = new RateKernel();
 	if(repast::RepastProcess::instance()->rank() == 0) props->writeToSVFile("./output/record.csv");
 	provider = new RepastHPCAgentPackageProvider(&context);
-	receiver = new RepastHPCAgentPackageReceiver(&context);
+	receiver = new RepastHPCAgentPackageReceiver(&context, &localPool);
+	ghostReceiver = new RepastHPCAgentPackageReceiver(&context, &ghostPool);
 
 	repast::Point<double> origin(0,0);
-	repast::Point<double> extent(WIDTH, HEIGHT);    
+	repast::Point<double> extent(params.width, params.height);    
 	repast::GridDimensions gd(origin, extent);
     
 	std::vector<int> processDims;
 	processDims.push_back(procPerx);
 	processDims.push_back(procPery); //Nº process = procPerx*procPery
     
-	discreteSpace = new repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >("AgentDiscreteSpace", gd, processDims, 10, comm);
+	// Ghost area as wide as the play radius, what play reads beyond the local bounds
+	int spaceBuffer = std::max(params.radius, 1);
+	discreteSpace = new repast::SharedDiscreteSpace<RepastHPCAgent, repast::WrapAroundBorders, repast::SimpleAdder<RepastHPCAgent> >("AgentDiscreteSpace", gd, processDims, spaceBuffer, comm);
 	
 	std::cout << "RANK " << repast::RepastProcess::instance()->rank() << " BOUNDS: " << discreteSpace->bounds().origin() << " " << discreteSpace->bounds().extents() << std::endl;
     
    	context.addProjection(discreteSpace);
+
+	spaceOrigin[0] = 0;
+	spaceOrigin[1] = 0;
+	spaceExtent[0] = params.width;
+	spaceExtent[1] = params.height;
+	cells->setBounds(discreteSpace->bounds());
+	halo = (fusedSync ? new HaloExchange(*comm, discreteSpace->bounds(), params.width, params.height, spaceBuffer) : nullptr);
+	if (ghostInterest) halo->setInterest(params.radius, props->contains("ghost.interest.cell.size") ? repast::strToInt(props->getProperty("ghost.interest.cell.size")) : 2);
+	if (codec) halo->setCodec(codec);
+	if (sharedTransport) halo->setSharedTransport((size_t)1024 * (props->contains("halo.shm.slot.kb") ? repast::strToInt(props->getProperty("halo.shm.slot.kb")) : 1024));
+	scratch.resize(pool->size());
     
 	// Data collection
 	// Create the data set builder
@@ -318,8 +488,20 @@ RepastHPCModel::~RepastHPCModel(){
 	delete props;
 	delete provider;
 	delete receiver;
+	delete ghostReceiver;
 	delete agentValues;
-	delete in;
+	delete fftPlans;
+	delete profiler;
+	delete pool;
+	delete table;
+	delete cells;
+	delete rates;
+	delete halo;
+	if (imbalanceFile) fclose(imbalanceFile);
+	delete codec;
+	if (compressionFile) fclose(compressionFile);
+	delete checkpoint;
+	delete fftVector;
 }
 
 /*
@@ -338,50 +520,59 @@ void RepastHPCModel::init(){
 	char newm[COM_BUFFER_SIZE] = "123456789";
 	FILE *fp;
 	u_int32_t idg; 
+	uint64_t line;
 
-        //Load fft vector file
-	int i;
-
-        fp = fopen(initialFFTVectorFile.c_str(),"r");
-        if( feof(fp) ) return ;
+	//Load fft vector file, shared by the processes of a node if binary
+	if (generatedFFTVector)
+		fftVector = new FFTVector(repast::strToInt(props->getProperty("scenario.fft.size")), scenarioParameters().seed);
+	else
+		fftVector = new FFTVector(initialFFTVectorFile, binaryFFTVector, *repast::RepastProcess::instance()->getCommunicator());
+	N = fftVector->size();
+	in = fftVector->data();
 
-        fscanf(fp, "%d", &N);
+	//Plan once for the whole run, agents reuse the plan and output buffer every tick
+	fftPlans->prepare(N, fftBatchSize, pool->size(), repast::RepastProcess::instance()->getCommunicator());
 
-        reinterpret_cast<fftw_complex*>(in);
-        in = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+	float xmin = discreteSpace->bounds().origin().getX();
+	float ymin = discreteSpace->bounds().origin().getY();
+	float xmax = discreteSpace->bounds().origin().getX() + discreteSpace->bounds().extents().getX();
+	float ymax = discreteSpace->bounds().origin().getY() + discreteSpace->bounds().extents().getY();
+	countOfAgents = 0;
 
-        for (i = 0; i < N; i++ ) {
-                fscanf(fp, "%lf %lf", &in[i][0], &in[i][1]);
-                if( feof(fp) ) {
-                        break ;
-                }
-        }
+	if (!restartFile.empty()){
+		restoreAgents(xmin, ymin, xmax, ymax);
+		return;
+	}
 
-        fclose(fp);
+	if (generatedAgents){
+		generateAgents(xmin, ymin, xmax, ymax, newm);
+		return;
+	}
 
-	float xmin = discreteSpace->dimensions().origin().getX();
-	float ymin = discreteSpace->dimensions().origin().getY();
-	float xmax = discreteSpace->dimensions().origin().getX() + discreteSpace->dimensions().extents().getX();
-	float ymax = discreteSpace->dimensions().origin().getY() + discreteSpace->dimensions().extents().getY();
-	countOfAgents = 0;
+	if (tiledAgents){
+		//Only the tiles covering the bounds are read, collective over all the processes
+		std::vector<TiledRecord> records;
+		TiledHeader header;
+		TiledAgents::read(initialAgentsFile, *repast::RepastProcess::instance()->getCommunicator(), (int)xmin, (int)ymin, (int)xmax, (int)ymax, records, &header);
+		if (rank == 0 && (header.width != params.width || header.height != params.height))
+			std::cout << initialAgentsFile << " was tiled for a " << header.width << "x" << header.height << " space, the model space is " << params.width << "x" << params.height << std::endl;
+		for (size_t r = 0; r < records.size(); r++)
+			addInitialAgent(records[r].key, records[r].x, records[r].y, newm);
+		return;
+	}
 
 	fp = fopen(initialAgentsFile.c_str(),"r");
+	if (fp == NULL) throw std::runtime_error("Can not open initial.agents.file " + initialAgentsFile);
 
-	while(1) {
+	//The line of an agent in the file is its random stream key, the same whatever process loads it
+	for(line = 0; ; line++) {
 		fscanf(fp, "%u %d %d %d", &idg, &x, &y, &z);
 		if( feof(fp) ) { 
 			break ;
 		}
       
 		if ( ( x >= xmin) && (x < xmax) && (y >= ymin) && (y < ymax) ){
-	                repast::Point<int> initialLocation(x,y);
-        	        repast::AgentId id(countOfAgents, rank, 0);
-                	id.currentRank(rank);
-                	RepastHPCAgent* agent = new RepastHPCAgent(id, N, in);
-                	agent->setm(newm); 
-                	context.addAgent(agent);
-                	discreteSpace->moveTo(id, initialLocation);
-			countOfAgents++;
+			addInitialAgent(line, x, y, newm);
 			//printf("rank %d(%d) 8: %d %d \n", rank, idg, x, y);
 		}
 
@@ -389,6 +580,230 @@ void RepastHPCModel::init(){
 	fclose(fp);
 }
 
+/*
+ *    Class: RepastHPCModel
+ * Function: scenarioParameters 
+ * --------------------
+ * Scenario of the generated initial state, the scenario.* keys of model.props
+ * with the space and the birth and death centers of the model
+ * 
+ * -: -
+ *
+ * returns: scenario parameters, the ones gen_file_init takes for the same agents
+ */
+ScenarioParameters RepastHPCModel::scenarioParameters(){
+	ScenarioParameters p;
+	p.agents = boost::lexical_cast<uint64_t>(props->getProperty("scenario.agents"));
+	p.width = params.width;
+	p.height = params.height;
+	p.tileSize = (props->contains("scenario.tile.size") ? repast::strToInt(props->getProperty("scenario.tile.size")) : 64);
+	if (p.tileSize < 1) p.tileSize = 1;
+	p.seed = (props->contains("scenario.seed") ? repast::strToUInt(props->getProperty("scenario.seed")) : 1);
+	p.distribution = (props->getProperty("scenario.distribution") == "clustered" ? SCENARIO_CLUSTERED : SCENARIO_UNIFORM);
+	p.spread = (props->contains("scenario.spread") ? repast::strToDouble(props->getProperty("scenario.spread")) : 30);
+	p.background = (props->contains("scenario.background") ? repast::strToDouble(props->getProperty("scenario.background")) : 0.2);
+	p.centerX[0] = params.centerBirthX;
+	p.centerY[0] = params.centerBirthY;
+	p.centerX[1] = params.centerDeathX;
+	p.centerY[1] = params.centerDeathY;
+	return p;
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: generateAgents 
+ * --------------------
+ * Creation of the agents of the scenario inside the bounds, without a file.
+ * Only the tiles covering the bounds are generated, by the threads of the
+ * process; the agents are the ones the tiled file written by gen_file_init
+ * for the same scenario holds, with the same keys, for any process layout.
+ * 
+ * xmin,ymin,xmax,ymax: bounds of the process, max excluded
+ * m: initial communication buffer
+ *
+ * returns: -
+ */
+void RepastHPCModel::generateAgents(float xmin, float ymin, float xmax, float ymax, char* m){
+	ScenarioParameters p = scenarioParameters();
+	Scenario s(p);
+	int tx0 = tiledClamp((int)xmin, p.tileSize, s.tilesPerRow());
+	int tx1 = tiledClamp((int)xmax - 1, p.tileSize, s.tilesPerRow());
+	int ty0 = tiledClamp((int)ymin, p.tileSize, s.tileRows());
+	int ty1 = tiledClamp((int)ymax - 1, p.tileSize, s.tileRows());
+
+	//Covered tiles in row major order, so their agents come in key order
+	std::vector<int> tiles;
+	std::vector<size_t> offset(1, 0);
+	for (int ty = ty0; ty <= ty1; ty++){
+		for (int tx = tx0; tx <= tx1; tx++){
+			int t = ty * s.tilesPerRow() + tx;
+			tiles.push_back(t);
+			offset.push_back(offset.back() + s.tileCount(t));
+		}
+	}
+
+	std::vector<TiledRecord> records(offset.back());
+	pool->parallelFor(tiles.size(), [&](int thread, size_t begin, size_t end){
+		for (size_t i = begin; i < end; i++)
+			s.generate(tiles[i], s.tileFirst(tiles[i]), s.tileFirst(tiles[i]) + s.tileCount(tiles[i]), &records[offset[i]]);
+	});
+
+	for (size_t r = 0; r < records.size(); r++)
+		if (records[r].x >= xmin && records[r].x < xmax && records[r].y >= ymin && records[r].y < ymax)
+			addInitialAgent(records[r].key, records[r].x, records[r].y, m);
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: restoreAgents 
+ * --------------------
+ * Creation of the agents of a checkpoint inside the bounds (restart.file),
+ * on any process layout. Agents keep their AgentId, the process keeps the
+ * agent counter of the process that had its rank, and the run goes on with
+ * the seed and from the tick after the checkpoint. Ghosts are exchanged
+ * before the first tick, as the synchronization that ended the tick of the
+ * checkpoint did.
+ * 
+ * xmin,ymin,xmax,ymax: bounds of the process, max excluded
+ *
+ * returns: -
+ */
+void RepastHPCModel::restoreAgents(float xmin, float ymin, float xmax, float ymax){
+	int rank = repast::RepastProcess::instance()->rank();
+	int bounds[4] = { (int)xmin, (int)ymin, (int)xmax, (int)ymax };
+	CheckpointHeader header;
+	int64_t count;
+	std::vector<char> records;
+	Checkpoint::restore(*repast::RepastProcess::instance()->getCommunicator(), restartFile, bounds, header, &count, records);
+
+	if (header.seed != repast::Random::instance()->seed()){
+		if (rank == 0) std::cout << restartFile << " was written with random.seed = " << header.seed << ", used instead of " << repast::Random::instance()->seed() << std::endl;
+		repast::Random::initialize(header.seed);
+	}
+	if (rank == 0 && header.comBufferSize != params.comBufferSize)
+		std::cout << restartFile << " was written with model.com.buffer.size = " << header.comBufferSize << std::endl;
+	startTick = header.tick;
+	countOfAgents = (int)count;
+
+	char m[COM_BUFFER_SIZE];
+	for (size_t i = 0; i < records.size(); i += header.recordBytes){
+		const CheckpointRecord* r = (const CheckpointRecord*)&records[i];
+		memset(m, 0, sizeof(m));
+		memcpy(m, r + 1, std::min(header.comBufferSize, COM_BUFFER_SIZE));
+		repast::Point<int> location(r->x, r->y);
+		repast::AgentId id(r->id, r->startingRank, r->type);
+		id.currentRank(rank);
+		RepastHPCAgent* agent = new (localPool) RepastHPCAgent(id, r->key, r->c, r->total, m, N, in);
+		context.addAgent(agent);
+		discreteSpace->moveTo(id, location);
+		if (soaStore) table->add(agent, r->x, r->y);
+	}
+
+	// The overlapped step posts its exchange at the start of every tick
+	if (!overlapSync) synchronize();
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: saveCheckpoint 
+ * --------------------
+ * Every checkpoint.every ticks, start the write of the local agents to the
+ * checkpoint, the write goes on during the next ticks; in the other ticks
+ * let the write in flight advance. Agents the last move took out of the
+ * bounds and the overlapped exchange has not sent yet are saved at their
+ * new location.
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void RepastHPCModel::saveCheckpoint(){
+	if (!checkpoint) return;
+	int tick = (int)repast::RepastProcess::instance()->getScheduleRunner().currentTick();
+	if (tick % checkpointEvery != 0){
+		checkpoint->progress();
+		return;
+	}
+
+	std::vector<RepastHPCAgent*> agents;
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iter    = context.localBegin();
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iterEnd = context.localEnd();
+	while (iter != iterEnd){
+		agents.push_back(*iter);
+		iter++;
+	}
+	std::map<RepastHPCAgent*, std::pair<int, int> > moved;
+	for (size_t i = 0; i < departures.size(); i++)
+		moved[departures[i].agent] = std::make_pair(departures[i].x, departures[i].y);
+
+	size_t recordBytes = Checkpoint::recordBytes(params.comBufferSize);
+	char* records = checkpoint->pack(agents.size(), params.comBufferSize);
+	std::vector<int> agentLoc;
+	for (size_t i = 0; i < agents.size(); i++){
+		CheckpointRecord* r = (CheckpointRecord*)(records + i * recordBytes);
+		const repast::AgentId& id = agents[i]->getId();
+		r->id = id.id();
+		r->startingRank = id.startingRank();
+		r->type = id.agentType();
+		r->key = agents[i]->getKey();
+		r->c = agents[i]->getC();
+		r->total = agents[i]->getTotal();
+		std::map<RepastHPCAgent*, std::pair<int, int> >::iterator d = moved.find(agents[i]);
+		if (d != moved.end()){
+			r->x = d->second.first;
+			r->y = d->second.second;
+		} else {
+			agentLoc.clear();
+			discreteSpace->getLocation(id, agentLoc);
+			r->x = agentLoc[0];
+			r->y = agentLoc[1];
+		}
+		agents[i]->getm((char*)(r + 1));
+	}
+	checkpoint->write(tick, repast::Random::instance()->seed(), countOfAgents);
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: resumeAt 
+ * --------------------
+ * First time of a repeating event after the tick a restart goes on from
+ * 
+ * start: time of the event in a run from the initial state
+ * interval: ticks between events
+ *
+ * returns: first time of the event after startTick
+ */
+double RepastHPCModel::resumeAt(double start, double interval){
+	if (start > startTick) return start;
+	return start + interval * (floor((startTick - start) / interval) + 1);
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: addInitialAgent 
+ * --------------------
+ * Creation of a local agent of the initial state
+ * 
+ * key: random stream key of the agent
+ * x,y: agent location, inside the bounds of the process
+ * m: initial communication buffer
+ *
+ * returns: -
+ */
+void RepastHPCModel::addInitialAgent(uint64_t key, int x, int y, char* m){
+	int rank = repast::RepastProcess::instance()->rank();
+	repast::Point<int> initialLocation(x,y);
+	repast::AgentId id(countOfAgents, rank, 0);
+	id.currentRank(rank);
+	RepastHPCAgent* agent = new (localPool) RepastHPCAgent(id, key, N, in);
+	agent->setm(m); 
+	context.addAgent(agent);
+	discreteSpace->moveTo(id, initialLocation);
+	if (soaStore) table->add(agent, x, y);
+	countOfAgents++;
+}
+
 
 /*
  *    Class: RepastHPCModel
@@ -418,88 +833,726 @@ void RepastHPCModel::printAgentsPosition(){
 
 /*
  *    Class: RepastHPCModel
- * Function: doSomething
+ * Function: wrap
  * --------------------
- * Run agents in every simulation step
+ * Wrap a coordinate around the borders of the space, as WrapAroundBorders does
+ * 
+ * v: coordinate
+ * dim: dimension, 0: x, 1: y
+ *
+ * returns: coordinate inside the space
+ */
+int RepastHPCModel::wrap(int v, int dim){
+	v = (v - spaceOrigin[dim]) % spaceExtent[dim];
+	return (v < 0 ? v + spaceExtent[dim] : v) + spaceOrigin[dim];
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: computeBatched
+ * --------------------
+ * Compute the FFT of the agents in batches of fftBatchSize vectors. Each batch
+ * input vector is copied into the contiguous batch buffer, the whole batch is
+ * transformed by one fftw_plan_many_dft plan and every agent consumes its
+ * slice of the output. Batches are shared out among the threads, each one
+ * using its own buffers. Agents left over after the last full batch are
+ * transformed one by one.
+ * 
+ * agents: local agents
+ * n: number of agents
+ *
+ * returns: -
+ */
+void RepastHPCModel::computeBatched(RepastHPCAgent** agents, size_t n){
+	fftw_plan p = fftPlans->plan(N, fftBatchSize);
+	size_t batches = n / fftBatchSize;
+
+	pool->parallelFor(batches, [&](int thread, size_t begin, size_t end){
+		fftw_complex *batchIn  = fftPlans->input(N, fftBatchSize, thread);
+		fftw_complex *batchOut = fftPlans->buffer(N, fftBatchSize, thread);
+
+		for (size_t b = begin; b < end; b++){
+			RepastHPCAgent **batch = &agents[b * fftBatchSize];
+			for (int j=0; j<fftBatchSize; j++)
+				memcpy(batchIn + j*N, batch[j]->getIn(), sizeof(fftw_complex) * N);
+			fftw_execute_dft(p, batchIn, batchOut);
+			for (int j=0; j<fftBatchSize; j++)
+				batch[j]->reduceFFT(batchOut + j*N);
+		}
+	});
+
+	size_t done = batches * fftBatchSize;
+	pool->parallelFor(n - done, [&](int thread, size_t begin, size_t end){
+		for (size_t i = done + begin; i < done + end; i++)
+			agents[i]->compute(fftPlans, thread);
+	});
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: stepObjects
+ * --------------------
+ * Run the agents of a simulation step through the agent objects. Every phase
+ * is shared out among the threads of the pool; changes to the context and the
+ * space (moves, births and deaths) are decided by the threads and applied by
+ * the main thread at the end of the phase.
+ * 
+ * agents: local agents
+ *
+ * returns: -
+ */
+void RepastHPCModel::stepObjects(std::vector<RepastHPCAgent*>& agents){
+	profiler->start(PHASE_PLAY);
+	if (cellEngine) cells->update(&context, discreteSpace);
+	playObjects(agents.data(), agents.size());
+	pool->parallelFor(agents.size(), [&](int thread, size_t begin, size_t end){
+		for (size_t i = begin; i < end; i++)
+			agents[i]->commitPlay();
+	});
+	profiler->stop(PHASE_PLAY);
+
+	profiler->start(PHASE_COMPUTE);
+	computeObjects(agents.data(), agents.size());
+	profiler->stop(PHASE_COMPUTE);
+
+	stepPopulation(agents);
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: stepOverlapped
+ * --------------------
+ * Run a simulation step through the agent objects hiding the fused exchange
+ * behind the work of the interior agents. The exchange of the state left by
+ * the previous step is posted first, then interior agents play and compute
+ * while it is in flight: their disk of play stays off the ghosts and off the
+ * outer ring of the bounds where immigrants land, so they meet the same
+ * opponents as after a blocking exchange. Boundary agents, and immigrants,
+ * play once the exchange is applied; payoffs are committed after every agent
+ * has played as in stepObjects.
  * 
  * -: -
  *
  * returns: -
  */
-void RepastHPCModel::doSomething(){
-	int whichRank = 0; 
-	bool dierequest = false, reproductionrequest = false;
-	char newm[COM_BUFFER_SIZE] = "123456789"; //amv
+void RepastHPCModel::stepOverlapped(){
+	profiler->start(PHASE_SYNC);
+	if (balanceDue()) balanceLoad();
+	CommMetrics::begin(COMM_HALO);
+	halo->post(&context, discreteSpace, receiver, ghostReceiver, &departures);
+	departures.clear();
+	CommMetrics::end();
+	profiler->stop(PHASE_SYNC);
 
-	if(repast::RepastProcess::instance()->rank() == whichRank) std::cout << " TICK " << repast::RepastProcess::instance()->getScheduleRunner().currentTick() << std::endl;
-	
-	std::vector<RepastHPCAgent*> agents;
-	//context.selectAgents(repast::SharedContext<RepastHPCAgent>::LOCAL, countOfAgents, agents);
-	context.selectAgents(repast::SharedContext<RepastHPCAgent>::LOCAL, agents);
+	// Interior agents first, boundary ones appended once they have played. The margin adds the largest move step to the radius
+	std::vector<RepastHPCAgent*>& agents = localAgents;
+	std::vector<int>& agentLoc = scratch[0].loc;
+	agents.clear();
+	boundaryAgents.clear();
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iter    = context.localBegin();
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iterEnd = context.localEnd();
+	while (iter != iterEnd){
+		agentLoc.clear();
+		discreteSpace->getLocation((*iter)->getId(), agentLoc);
+		if (halo->interior(agentLoc[0], agentLoc[1], params.radius + 1)) agents.push_back(*iter);
+		else boundaryAgents.push_back(*iter);
+		iter++;
+	}
+	size_t numInterior = agents.size();
+
+	profiler->start(PHASE_PLAY);
+	if (cellEngine) cells->update(&context, discreteSpace);
+	playObjects(agents.data(), numInterior);
+	profiler->stop(PHASE_PLAY);
+
+	profiler->start(PHASE_SYNC);
+	CommMetrics::begin(COMM_HALO);
+	halo->progress();
+	CommMetrics::end();
+	profiler->stop(PHASE_SYNC);
+
+	profiler->start(PHASE_COMPUTE);
+	computeObjects(agents.data(), numInterior);
+	profiler->stop(PHASE_COMPUTE);
+
+	profiler->start(PHASE_SYNC);
+	CommMetrics::begin(COMM_HALO);
+	halo->complete(&context, discreteSpace, receiver, ghostReceiver, &boundaryAgents);
+	CommMetrics::end();
+	RepastHPCAgent::nextEpoch();
+	profiler->stop(PHASE_SYNC);
+
+	profiler->start(PHASE_PLAY);
+	if (cellEngine) cells->update(&context, discreteSpace);
+	playObjects(boundaryAgents.data(), boundaryAgents.size());
+	agents.insert(agents.end(), boundaryAgents.begin(), boundaryAgents.end());
+	countAgentRoles(agents.size());	// roles once the exchange is applied
+	pool->parallelFor(agents.size(), [&](int thread, size_t begin, size_t end){
+		for (size_t i = begin; i < end; i++)
+			agents[i]->commitPlay();
+	});
+	profiler->stop(PHASE_PLAY);
+
+	profiler->start(PHASE_COMPUTE);
+	computeObjects(agents.data() + numInterior, agents.size() - numInterior);
+	profiler->stop(PHASE_COMPUTE);
 
-	if (agents.size() == 0) return;
+	stepPopulation(agents);
+}
 
-	std::vector<RepastHPCAgent*>::iterator it = agents.begin();
-	while(it != agents.end()){
-        	//std::cout << "Play agent: " << (*it)->getId() << std::endl;
-		(*it)->play(&context, discreteSpace);
-        	(*it)->compute();
-		it++;
+/*
+ *    Class: RepastHPCModel
+ * Function: playObjects
+ * --------------------
+ * Play of a set of agents, shared out among the threads. Payoffs are left
+ * to commit.
+ * 
+ * agents: agents
+ * n: number of agents
+ *
+ * returns: -
+ */
+void RepastHPCModel::playObjects(RepastHPCAgent** agents, size_t n){
+	if (cellEngine){
+		pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+			std::vector<int>& agentLoc = scratch[thread].loc;
+			for (size_t i = begin; i < end; i++){
+				agentLoc.clear();
+				discreteSpace->getLocation(agents[i]->getId(), agentLoc);
+				(agents[i]->*playKernel)(cells, agentLoc[0], agentLoc[1], scratch[thread]);
+			}
+		});
+	} else {
+		pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++)
+				agents[i]->play(&context, discreteSpace, scratch[thread]);
+		});
 	}
+}
 
-    	it = agents.begin();
-    	while(it != agents.end()){
-		(*it)->move(discreteSpace);
-		it++;
-    	}
- 
-   	it = agents.begin();
-    	while(it != agents.end()){
-		reproductionrequest = (*it)->reproduction(discreteSpace);
+/*
+ *    Class: RepastHPCModel
+ * Function: computeObjects
+ * --------------------
+ * FFT of a set of agents, batched or one by one
+ * 
+ * agents: agents
+ * n: number of agents
+ *
+ * returns: -
+ */
+void RepastHPCModel::computeObjects(RepastHPCAgent** agents, size_t n){
+	if (fftBatched){
+		computeBatched(agents, n);
+	} else {
+		pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++)
+				agents[i]->compute(fftPlans, thread);
+		});
+	}
+}
 
-		if (reproductionrequest){
-			repast::AgentId id = (*it)->getId();
-			//std::cout << "Agent to reproduct: " << id << std::endl;
+/*
+ *    Class: RepastHPCModel
+ * Function: stepPopulation
+ * --------------------
+ * Move, reproduction and die phases of a simulation step through the agent
+ * objects
+ * 
+ * agents: local agents
+ *
+ * returns: -
+ */
+void RepastHPCModel::stepPopulation(std::vector<RepastHPCAgent*>& agents){
+	char newm[COM_BUFFER_SIZE] = "123456789"; //amv
+
+	profiler->start(PHASE_MOVE);
+	nextX.resize(agents.size());
+	nextY.resize(agents.size());
+	agentKeys.resize(agents.size());
+	pool->parallelFor(agents.size(), [&](int thread, size_t begin, size_t end){
+		std::vector<int>& agentNewLoc = scratch[thread].loc;
+		for (size_t i = begin; i < end; i++){
+			agents[i]->nextLocation(discreteSpace, agentNewLoc);
+			nextX[i]     = agentNewLoc[0];
+			nextY[i]     = agentNewLoc[1];
+			agentKeys[i] = agents[i]->getKey();
+		}
+	});
+
+	agentNewLoc.resize(2);
+	for (size_t i = 0; i < agents.size(); i++){
+		agentNewLoc[0] = nextX[i];
+		agentNewLoc[1] = nextY[i];
+		discreteSpace->moveTo(agents[i]->getId(), agentNewLoc);
+	}
+	profiler->stop(PHASE_MOVE);
+ 
+	profiler->start(PHASE_REPRODUCTION);
+	int rank = repast::RepastProcess::instance()->rank();
+	if (batchRates){
+		// Locations as the space keeps them after moveTo
+		pool->parallelFor(agents.size(), [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++){
+				nextX[i] = wrap(nextX[i], 0);
+				nextY[i] = wrap(nextY[i], 1);
+			}
+		});
+		rates->evaluate(pool, agentKeys.data(), nextX.data(), nextY.data(), agents.size(),
+		                RepastHPCAgent::getSeed(), RepastHPCAgent::getTick());
 
-			int rank = repast::RepastProcess::instance()->rank();
- 			std::vector<int> initialLocation;
-			discreteSpace->getLocation((*it)->getId(), initialLocation);
+		const uint32_t *births = rates->getBirths();
+		for (size_t b = 0; b < rates->numBirths(); b++){
+			size_t i = births[b];
 			repast::AgentId newid(countOfAgents, rank, 0);
 			countOfAgents++;
-			id.currentRank(rank);
-			RepastHPCAgent* agent = new RepastHPCAgent(newid, N, in);
+			RepastHPCAgent* agent = new (localPool) RepastHPCAgent(newid, agents[i]->birthKey(), N, in);
 			agent->setm(newm); 
 			context.addAgent(agent);
-			discreteSpace->moveTo(newid, initialLocation);
-
-			//std::cout << "Agent created: " << newid << std::endl;
+			agentNewLoc[0] = nextX[i];
+			agentNewLoc[1] = nextY[i];
+			discreteSpace->moveTo(newid, agentNewLoc);
+			if (fusedSync && !halo->interior(nextX[i], nextY[i], 0)) departures.push_back({agent, nextX[i], nextY[i]});
 		}
+	} else {
+		requests.resize(agents.size());
+		pool->parallelFor(agents.size(), [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++)
+				requests[i] = agents[i]->reproduction(discreteSpace, scratch[thread].loc);
+		});
+
+		for (size_t i = 0; i < agents.size(); i++){
+			if (requests[i]){
+				//std::cout << "Agent to reproduct: " << agents[i]->getId() << std::endl;
+
+ 				std::vector<int>& initialLocation = scratch[0].loc;
+				initialLocation.clear();
+				discreteSpace->getLocation(agents[i]->getId(), initialLocation);
+				repast::AgentId newid(countOfAgents, rank, 0);
+				countOfAgents++;
+				RepastHPCAgent* agent = new (localPool) RepastHPCAgent(newid, agents[i]->birthKey(), N, in);
+				agent->setm(newm); 
+				context.addAgent(agent);
+				discreteSpace->moveTo(newid, initialLocation);
+				if (fusedSync && !halo->interior(initialLocation[0], initialLocation[1], 0)) departures.push_back({agent, initialLocation[0], initialLocation[1]});
 
-		it++;
-    	}
+				//std::cout << "Agent created: " << newid << std::endl;
+			}
+		}
+	}
+	profiler->stop(PHASE_REPRODUCTION);
    	
-	it = agents.begin();
-    	while(it != agents.end()){
-		dierequest = (*it)->die(discreteSpace);
-		//std::cout << "dierequest:" << dierequest << std::endl;
-
-		if (dierequest){
-			repast::AgentId id = (*it)->getId();
-			//std::cout << "Agent to die: " << id << std::endl;
-			repast::RepastProcess::instance()->agentRemoved(id);
+	profiler->start(PHASE_DIE);
+	if (batchRates){
+		const uint32_t *deaths = rates->getDeaths();
+		for (size_t d = 0; d < rates->numDeaths(); d++){
+			repast::AgentId id = agents[deaths[d]]->getId();
+			if (!fusedSync) repast::RepastProcess::instance()->agentRemoved(id);	// Repast exchange bookkeeping
 			context.removeAgent(id);
 		}
+	} else {
+		pool->parallelFor(agents.size(), [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++)
+				requests[i] = agents[i]->die(discreteSpace, scratch[thread].loc);
+		});
 
-		it++;
-    	}
+		for (size_t i = 0; i < agents.size(); i++){
+			if (requests[i]){
+				repast::AgentId id = agents[i]->getId();
+				//std::cout << "Agent to die: " << id << std::endl;
+				if (!fusedSync) repast::RepastProcess::instance()->agentRemoved(id);	// Repast exchange bookkeeping
+				context.removeAgent(id);
+			}
+		}
+	}
 
-	discreteSpace->balance();
-    	repast::RepastProcess::instance()->synchronizeAgentStatus<RepastHPCAgent, RepastHPCAgentPackage, RepastHPCAgentPackageProvider, RepastHPCAgentPackageReceiver>(context, *provider, *receiver, *receiver);
-    
-    	repast::RepastProcess::instance()->synchronizeProjectionInfo<RepastHPCAgent, RepastHPCAgentPackage, RepastHPCAgentPackageProvider, RepastHPCAgentPackageReceiver>(context, *provider, *receiver, *receiver);
+	// Survivors the move took out of the local bounds, the only agents the fused exchange checks for migration
+	if (fusedSync){
+		const uint32_t *deaths = rates->getDeaths();
+		size_t numDeaths = (batchRates ? rates->numDeaths() : 0);
+		for (size_t i = 0; i < agents.size(); i++){
+			int x = wrap(nextX[i], 0);
+			int y = wrap(nextY[i], 1);
+			if (halo->interior(x, y, 0)) continue;
+			bool dead = (batchRates ? std::binary_search(deaths, deaths + numDeaths, (uint32_t)i) : requests[i] != 0);
+			if (!dead) departures.push_back({agents[i], x, y});
+		}
+	}
+	profiler->stop(PHASE_DIE);
+}
 
-	repast::RepastProcess::instance()->synchronizeAgentStates<RepastHPCAgentPackage, RepastHPCAgentPackageProvider, RepastHPCAgentPackageReceiver>(*provider, *receiver);
-    
+/*
+ *    Class: RepastHPCModel
+ * Function: stepTable
+ * --------------------
+ * Run the agents of a simulation step through the columns of the agent
+ * table: locations, keys and counters are read from contiguous arrays instead
+ * of space lookups on every agent object. Context and space are updated by the
+ * main thread as in stepObjects, and the table with them.
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void RepastHPCModel::stepTable(){
+	char newm[COM_BUFFER_SIZE] = "123456789"; //amv
+	size_t n = table->size();
+	RepastHPCAgent** agents = table->getAgent();
+	int *x = table->getX();
+	int *y = table->getY();
+	uint64_t *key = table->getKey();
+
+	profiler->start(PHASE_PLAY);
+	if (cellEngine){
+		cells->update(&context, discreteSpace);
+		pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++)
+				(agents[i]->*playKernel)(cells, x[i], y[i], scratch[thread]);
+		});
+	} else {
+		pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++)
+				agents[i]->play(&context, discreteSpace, x[i], y[i], scratch[thread]);
+		});
+	}
+	pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+		for (size_t i = begin; i < end; i++)
+			agents[i]->commitPlay();
+	});
+	profiler->stop(PHASE_PLAY);
+
+	profiler->start(PHASE_COMPUTE);
+	if (fftBatched){
+		computeBatched(agents, n);
+	} else {
+		pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++)
+				agents[i]->compute(fftPlans, thread);
+		});
+	}
+	profiler->stop(PHASE_COMPUTE);
+
+	profiler->start(PHASE_MOVE);
+	pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+		for (size_t i = begin; i < end; i++){
+			x[i] = wrap(x[i] + RepastHPCAgent::moveStep(key[i], 0), 0);
+			y[i] = wrap(y[i] + RepastHPCAgent::moveStep(key[i], 1), 1);
+		}
+	});
+
+	agentNewLoc.resize(2);
+	for (size_t i = 0; i < n; i++){
+		agentNewLoc[0] = x[i];
+		agentNewLoc[1] = y[i];
+		discreteSpace->moveTo(agents[i]->getId(), agentNewLoc);
+	}
+	profiler->stop(PHASE_MOVE);
+
+	profiler->start(PHASE_REPRODUCTION);
+	const uint32_t *births = nullptr;
+	size_t numBirths = 0;
+	if (batchRates){
+		// Births and deaths are both decided on the locations after the move
+		rates->evaluate(pool, key, x, y, n, RepastHPCAgent::getSeed(), RepastHPCAgent::getTick());
+		births    = rates->getBirths();
+		numBirths = rates->numBirths();
+	} else {
+		requests.resize(n);
+		pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++)
+				requests[i] = RepastHPCAgent::reproduces(key[i], x[i], y[i]);
+		});
+		indexes.clear();
+		for (size_t i = 0; i < n; i++)
+			if (requests[i]) indexes.push_back(i);
+		births    = indexes.data();
+		numBirths = indexes.size();
+	}
+
+	// New rows are appended after the first n ones, columns may be reallocated
+	int rank = repast::RepastProcess::instance()->rank();
+	for (size_t b = 0; b < numBirths; b++){
+		size_t i = births[b];
+		int bx = table->getX()[i];
+		int by = table->getY()[i];
+		repast::AgentId newid(countOfAgents, rank, 0);
+		countOfAgents++;
+		RepastHPCAgent* agent = new (localPool) RepastHPCAgent(newid, table->getAgent()[i]->birthKey(), N, in);
+		agent->setm(newm); 
+		context.addAgent(agent);
+		agentNewLoc[0] = bx;
+		agentNewLoc[1] = by;
+		discreteSpace->moveTo(newid, agentNewLoc);
+		table->add(agent, bx, by);
+	}
+	profiler->stop(PHASE_REPRODUCTION);
+
+	profiler->start(PHASE_DIE);
+	const uint32_t *deaths = nullptr;
+	size_t numDeaths = 0;
+	if (batchRates){
+		deaths    = rates->getDeaths();
+		numDeaths = rates->numDeaths();
+	} else {
+		x = table->getX();
+		y = table->getY();
+		key = table->getKey();
+		pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+			for (size_t i = begin; i < end; i++)
+				requests[i] = RepastHPCAgent::dies(key[i], x[i], y[i]);
+		});
+		indexes.clear();
+		for (size_t i = 0; i < n; i++)
+			if (requests[i]) indexes.push_back(i);
+		deaths    = indexes.data();
+		numDeaths = indexes.size();
+	}
+
+	// Removing from the last row down, the row moved into a hole has already been visited
+	for (size_t d = numDeaths; d-- > 0; ){
+		size_t i = deaths[d];
+		repast::AgentId id = table->getAgent()[i]->getId();
+		table->remove(i);
+		if (!fusedSync) repast::RepastProcess::instance()->agentRemoved(id);	// Repast exchange bookkeeping
+		context.removeAgent(id);
+	}
+
+	// Rows out of the local bounds, the only agents the fused exchange checks for migration
+	if (fusedSync){
+		n = table->size();
+		agents = table->getAgent();
+		x = table->getX();
+		y = table->getY();
+		for (size_t i = 0; i < n; i++)
+			if (!halo->interior(x[i], y[i], 0)) departures.push_back({agents[i], x[i], y[i]});
+	}
+	profiler->stop(PHASE_DIE);
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: balanceDue
+ * --------------------
+ * Check if the load is rebalanced in this tick
+ * 
+ * -: -
+ *
+ * returns: true every balance.every ticks
+ */
+bool RepastHPCModel::balanceDue(){
+	int tick = (int)repast::RepastProcess::instance()->getScheduleRunner().currentTick();
+	return balanceEvery > 0 && tick % balanceEvery == 0;
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: balanceLoad
+ * --------------------
+ * Move the process boundaries to even out agents, or the time spent on them
+ * since the last rebalance (balance.weight = time), and bring the cell grid
+ * to the new bounds. Ghosts are sent again by the exchange that follows.
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void RepastHPCModel::balanceLoad(){
+	CommMetrics::begin(COMM_REBALANCE);
+	// Agents out of the new bounds move in the bulk migration, all local agents are in bounds after it
+	if (halo->rebalance(&context, discreteSpace, receiver, balanceByTime ? workSinceBalance : 0)){
+		cells->setBounds(halo->bounds());
+		departures.clear();
+	}
+	CommMetrics::end();
+	workSinceBalance = 0;
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: recordImbalance
+ * --------------------
+ * Reduce local agents and tick time out of the exchanges over all processes,
+ * rank 0 writes max, mean and max / mean of both to output/imbalance.csv
+ * 
+ * work: time of the tick out of the exchanges, in secs
+ *
+ * returns: -
+ */
+void RepastHPCModel::recordImbalance(double work){
+	boost::mpi::communicator* comm = repast::RepastProcess::instance()->getCommunicator();
+	double local[2] = {0, work * 1000};
+	double maxima[2], sums[2];
+
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iter    = context.localBegin();
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iterEnd = context.localEnd();
+	while (iter != iterEnd){
+		local[0]++;
+		iter++;
+	}
+
+	boost::mpi::reduce(*comm, local, 2, maxima, boost::mpi::maximum<double>(), 0);
+	boost::mpi::reduce(*comm, local, 2, sums, std::plus<double>(), 0);
+	if (imbalanceFile){
+		double meanAgents = sums[0] / comm->size();
+		double meanWork   = sums[1] / comm->size();
+		fprintf(imbalanceFile, "%d,%.0f,%.2f,%.3f,%.3f,%.3f,%.3f\n", (int)repast::RepastProcess::instance()->getScheduleRunner().currentTick(),
+		        maxima[0], meanAgents, meanAgents > 0 ? maxima[0] / meanAgents : 1.0,
+		        maxima[1], meanWork, meanWork > 0 ? maxima[1] / meanWork : 1.0);
+	}
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: recordCompression
+ * --------------------
+ * Reduce the compression counters of the tick over all processes, rank 0
+ * writes messages, bytes before and after encoding, their ratio and the max
+ * encode and decode time of a process to output/compression.csv
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void RepastHPCModel::recordCompression(){
+	boost::mpi::communicator* comm = repast::RepastProcess::instance()->getCommunicator();
+	const PayloadStats& stats = codec->tickStats();
+	double counts[4] = {stats.messages, stats.compressed, stats.rawBytes, stats.wireBytes};
+	double times[2]  = {stats.encodeTime * 1000, stats.decodeTime * 1000};
+	double sums[4], maxima[2];
+
+	boost::mpi::reduce(*comm, counts, 4, sums, std::plus<double>(), 0);
+	boost::mpi::reduce(*comm, times, 2, maxima, boost::mpi::maximum<double>(), 0);
+	codec->resetStats();
+	if (compressionFile)
+		fprintf(compressionFile, "%d,%.0f,%.0f,%.0f,%.0f,%.3f,%.3f,%.3f\n", (int)repast::RepastProcess::instance()->getScheduleRunner().currentTick(),
+		        sums[0], sums[1], sums[2], sums[3], sums[2] > 0 ? sums[3] / sums[2] : 1.0, maxima[0], maxima[1]);
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: synchronize
+ * --------------------
+ * Exchange migrated agents, ghosts and ghost states with the other processes
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void RepastHPCModel::synchronize(){
+	profiler->start(PHASE_SYNC);
+	if (fusedSync){
+		// Migrations, ghosts and ghost states in one message per neighbor
+		if (balanceDue()) balanceLoad();
+		CommMetrics::begin(COMM_HALO);
+		halo->exchange(&context, discreteSpace, receiver, ghostReceiver, &departures);
+		departures.clear();
+		CommMetrics::end();
+	} else {
+		CommMetrics::begin(COMM_BALANCE);
+		discreteSpace->balance();
+		CommMetrics::begin(COMM_STATUS);
+		repast::RepastProcess::instance()->synchronizeAgentStatus<RepastHPCAgent, RepastHPCAgentPackage, RepastHPCAgentPackageProvider, RepastHPCAgentPackageReceiver>(context, *provider, *receiver, *receiver);
+
+		// Agents first seen as ghosts come from the ghost pool
+		CommMetrics::begin(COMM_PROJECTION);
+		repast::RepastProcess::instance()->synchronizeProjectionInfo<RepastHPCAgent, RepastHPCAgentPackage, RepastHPCAgentPackageProvider, RepastHPCAgentPackageReceiver>(context, *provider, *receiver, *ghostReceiver);
+
+		CommMetrics::begin(COMM_STATES);
+		if (deltaSync)
+			repast::RepastProcess::instance()->synchronizeAgentStates<RepastHPCAgentDelta, RepastHPCAgentPackageProvider, RepastHPCAgentPackageReceiver>(*provider, *receiver);
+		else
+			repast::RepastProcess::instance()->synchronizeAgentStates<RepastHPCAgentPackage, RepastHPCAgentPackageProvider, RepastHPCAgentPackageReceiver>(*provider, *receiver);
+		CommMetrics::end();
+	}
+	RepastHPCAgent::nextEpoch();
+
+	if (soaStore) table->sync(&context, discreteSpace);
+	profiler->stop(PHASE_SYNC);
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: countAgentRoles
+ * --------------------
+ * Count the local agents and the ghosts for the pool reports. Objects keep
+ * the pool they were created from when their role changes, all the objects
+ * of both pools are in the context, so the ghosts are the objects that are
+ * not local.
+ * 
+ * local: number of local agents, taken from the list the step already built
+ *
+ * returns: -
+ */
+void RepastHPCModel::countAgentRoles(size_t local){
+	localPool.countRole(local);
+	ghostPool.countRole(localPool.size() + ghostPool.size() - local);
+}
+
+/*
+ *    Class: RepastHPCModel
+ * Function: doSomething
+ * --------------------
+ * Run agents in every simulation step
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void RepastHPCModel::doSomething(){
+	int whichRank = 0; 
+
+	if(repast::RepastProcess::instance()->rank() == whichRank) std::cout << " TICK " << repast::RepastProcess::instance()->getScheduleRunner().currentTick() << std::endl;
+	
+	std::vector<RepastHPCAgent*>& agents = localAgents;
+	bool idle = false;
+	if (overlapSync){
+		// Agents are listed by stepOverlapped once the exchange has taken the emigrants out
+	} else if (!soaStore){
+		//context.selectAgents(repast::SharedContext<RepastHPCAgent>::LOCAL, countOfAgents, agents);
+		// Local agents listed into reused storage, selectAgents would build a new shuffled copy every tick
+		agents.clear();
+		repast::SharedContext<RepastHPCAgent>::const_local_iterator iter    = context.localBegin();
+		repast::SharedContext<RepastHPCAgent>::const_local_iterator iterEnd = context.localEnd();
+		while (iter != iterEnd){
+			agents.push_back(*iter);
+			iter++;
+		}
+		idle = (agents.size() == 0);
+		countAgentRoles(agents.size());	// roles left by the initial state or the synchronization of the tick before
+	} else {
+		idle = (table->size() == 0);
+		countAgentRoles(table->size());
+	}
+	// The fused exchange is a collective of the neighbors, a process without agents still takes part
+	if (idle && !fusedSync){
+		if (imbalanceReport) recordImbalance(0);
+		CommMetrics::endTick((int)repast::RepastProcess::instance()->getScheduleRunner().currentTick());
+		saveCheckpoint();
+		return;
+	}
+
+	RepastHPCAgent::setStep(repast::Random::instance()->seed(), (uint32_t)repast::RepastProcess::instance()->getScheduleRunner().currentTick());
+
+	double work = profiler->elapsedTime(PHASE_SYNC) - profiler->elapsedTime(PHASE_TICK);
+	profiler->start(PHASE_TICK);
+	if (overlapSync){
+		stepOverlapped();
+	} else {
+		if (!idle){
+			if (soaStore) stepTable();
+			else stepObjects(agents);
+		}
+		synchronize();
+	}
+	profiler->stop(PHASE_TICK);
+
+	// Tick time out of the exchanges, what the balance evens out
+	work += profiler->elapsedTime(PHASE_TICK) - profiler->elapsedTime(PHASE_SYNC);
+	workSinceBalance += work;
+	if (imbalanceReport) recordImbalance(work);
+	if (codec) recordCompression();
+	CommMetrics::endTick((int)repast::RepastProcess::instance()->getScheduleRunner().currentTick());
+	saveCheckpoint();
 }
 
 /*
@@ -513,13 +1566,14 @@ void RepastHPCModel::doSomething(){
  * returns: -
  */
 void RepastHPCModel::initSchedule(repast::ScheduleRunner& runner){
-	runner.scheduleEvent(2, 1, repast::Schedule::FunctorPtr(new repast::MethodFunctor<RepastHPCModel> (this, &RepastHPCModel::doSomething)));
+	// A restart goes on from the tick after the checkpoint
+	runner.scheduleEvent(resumeAt(2, 1), 1, repast::Schedule::FunctorPtr(new repast::MethodFunctor<RepastHPCModel> (this, &RepastHPCModel::doSomething)));
 	runner.scheduleEndEvent(repast::Schedule::FunctorPtr(new repast::MethodFunctor<RepastHPCModel> (this, &RepastHPCModel::recordResults)));
 	runner.scheduleStop(stopAt);
 	
 	// Data collection
-	runner.scheduleEvent(1.5, 5, repast::Schedule::FunctorPtr(new repast::MethodFunctor<repast::DataSet>(agentValues, &repast::DataSet::record)));
-	runner.scheduleEvent(10.6, 10, repast::Schedule::FunctorPtr(new repast::MethodFunctor<repast::DataSet>(agentValues, &repast::DataSet::write)));
+	runner.scheduleEvent(resumeAt(1.5, 5), 5, repast::Schedule::FunctorPtr(new repast::MethodFunctor<repast::DataSet>(agentValues, &repast::DataSet::record)));
+	runner.scheduleEvent(resumeAt(10.6, 10), 10, repast::Schedule::FunctorPtr(new repast::MethodFunctor<repast::DataSet>(agentValues, &repast::DataSet::write)));
 	runner.scheduleEndEvent(repast::Schedule::FunctorPtr(new repast::MethodFunctor<repast::DataSet>(agentValues, &repast::DataSet::record)));
 	runner.scheduleEndEvent(repast::Schedule::FunctorPtr(new repast::MethodFunctor<repast::DataSet>(agentValues, &repast::DataSet::write)));
 	//runner.scheduleEvent(3, repast::Schedule::FunctorPtr(new repast::MethodFunctor<RepastHPCModel> (this, &RepastHPCModel::printAgentsPosition)));
@@ -538,6 +1592,21 @@ void RepastHPCModel::initSchedule(repast::ScheduleRunner& runner){
  * returns: -
  */
 void RepastHPCModel::recordResults(){
+	if (checkpoint) checkpoint->finish();
+	profiler->report(repast::RepastProcess::instance()->getCommunicator(), "./output/profile.csv");
+	CommMetrics::report(repast::RepastProcess::instance()->getCommunicator(), "./output");
+	// Roles left by the last synchronization, counted once on the context
+	size_t local = 0;
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iter    = context.localBegin();
+	repast::SharedContext<RepastHPCAgent>::const_local_iterator iterEnd = context.localEnd();
+	while (iter != iterEnd){
+		local++;
+		iter++;
+	}
+	countAgentRoles(local);
+	localPool.report(repast::RepastProcess::instance()->getCommunicator());
+	ghostPool.report(repast::RepastProcess::instance()->getCommunicator());
+
 	if(repast::RepastProcess::instance()->rank() == 0){
 		props->putProperty("Result","Passed");
 		std::vector<std::string> keyOrder;
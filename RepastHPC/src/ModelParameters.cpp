@@ -0,0 +1,73 @@
+/* ModelParameters.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdexcept>
+#include "repast_hpc/Utilities.h"
+#include "ModelParameters.h"
+#include "Model.h"
+
+/*
+ *    Class: ModelParameters  
+ * Function: ModelParameters
+ * --------------------
+ * ModelParameters constructor, compiled in defaults
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+ModelParameters::ModelParameters(): comBufferSize(COM_BUFFER_SIZE), width(WIDTH), height(HEIGHT), radius(RADIOUS),
+		maxAgentsToPlay(MAX_AGENTS_TO_PLAY), birthRate(BIRTH_RATE), deathRate(DEATH_RATE),
+		centerBirthX(CENTER_BIRTH_X), centerBirthY(CENTER_BIRTH_Y), centerDeathX(CENTER_DEATH_X), centerDeathY(CENTER_DEATH_Y){
+}
+
+/*
+ *    Class: ModelParameters  
+ * Function: read
+ * --------------------
+ * Override the defaults with the model.* properties present in model.props
+ * 
+ * props: run properties
+ *
+ * returns: -, throws std::invalid_argument for out of range values
+ */
+void ModelParameters::read(repast::Properties* props){
+	if (props->contains("model.com.buffer.size"))		comBufferSize   = repast::strToInt(props->getProperty("model.com.buffer.size"));
+	if (props->contains("model.width"))			width           = repast::strToInt(props->getProperty("model.width"));
+	if (props->contains("model.height"))			height          = repast::strToInt(props->getProperty("model.height"));
+	if (props->contains("model.radius"))			radius          = repast::strToInt(props->getProperty("model.radius"));
+	if (props->contains("model.max.agents.to.play"))	maxAgentsToPlay = repast::strToInt(props->getProperty("model.max.agents.to.play"));
+	if (props->contains("model.birth.rate"))		birthRate       = repast::strToDouble(props->getProperty("model.birth.rate"));
+	if (props->contains("model.death.rate"))		deathRate       = repast::strToDouble(props->getProperty("model.death.rate"));
+	if (props->contains("model.center.birth.x"))		centerBirthX    = repast::strToInt(props->getProperty("model.center.birth.x"));
+	if (props->contains("model.center.birth.y"))		centerBirthY    = repast::strToInt(props->getProperty("model.center.birth.y"));
+	if (props->contains("model.center.death.x"))		centerDeathX    = repast::strToInt(props->getProperty("model.center.death.x"));
+	if (props->contains("model.center.death.y"))		centerDeathY    = repast::strToInt(props->getProperty("model.center.death.y"));
+
+	if (comBufferSize < 1 || comBufferSize > COM_BUFFER_SIZE)
+		throw std::invalid_argument("model.com.buffer.size must be in [1, COM_BUFFER_SIZE]");
+	if (width < 1 || height < 1)
+		throw std::invalid_argument("model.width and model.height must be positive");
+	if (radius < 0 || maxAgentsToPlay < 0)
+		throw std::invalid_argument("model.radius and model.max.agents.to.play must not be negative");
+}
@@ -0,0 +1,316 @@
+/* PayloadCodec.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <mpi.h>
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#include "PayloadCodec.h"
+
+/*
+ * Function: putVarint
+ * --------------------
+ * Write an unsigned value 7 bits per byte, low bits first
+ * 
+ * p: destination
+ * v: value
+ *
+ * returns: end of the written bytes
+ */
+static inline char* putVarint(char* p, size_t v){
+	while (v >= 0x80){
+		*p++ = (char)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (char)v;
+	return p;
+}
+
+/*
+ * Function: getVarint
+ * --------------------
+ * Read a value written by putVarint
+ * 
+ * p: source
+ * end: end of the source
+ * v: value read
+ *
+ * returns: end of the read bytes
+ */
+static inline const char* getVarint(const char* p, const char* end, size_t* v){
+	size_t value = 0;
+	int shift = 0;
+	while (p < end){
+		unsigned char b = (unsigned char)*p++;
+		value |= (size_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)){
+			*v = value;
+			return p;
+		}
+		shift += 7;
+	}
+	throw std::runtime_error("PayloadCodec: truncated message");
+}
+
+/*
+ * Function: encodeZeroRuns
+ * --------------------
+ * Write a sequence of (literal length, literal bytes, zero run length)
+ * tokens, zero runs at least PAYLOAD_ZERO_RUN_MIN long, or up to the end
+ * 
+ * src: raw bytes
+ * n: number of raw bytes
+ * dst: destination, at least n + n / 64 + 16 bytes
+ *
+ * returns: bytes written
+ */
+static size_t encodeZeroRuns(const char* src, size_t n, char* dst){
+	char* p = dst;
+	size_t i = 0;
+	while (i < n){
+		size_t start = i;
+		size_t zeros = 0;
+		while (i < n){
+			if (src[i] != 0){
+				i++;
+				continue;
+			}
+			zeros = 1;
+			while (i + zeros < n && src[i + zeros] == 0) zeros++;
+			if (zeros >= PAYLOAD_ZERO_RUN_MIN || i + zeros == n) break;
+			i += zeros;
+			zeros = 0;
+		}
+		p = putVarint(p, i - start);
+		memcpy(p, src + start, i - start);
+		p += i - start;
+		p = putVarint(p, zeros);
+		i += zeros;
+	}
+	return p - dst;
+}
+
+/*
+ * Function: decodeZeroRuns
+ * --------------------
+ * Read the tokens written by encodeZeroRuns
+ * 
+ * src: encoded bytes
+ * n: number of encoded bytes
+ * dst: destination
+ * size: number of raw bytes
+ *
+ * returns: -
+ */
+static void decodeZeroRuns(const char* src, size_t n, char* dst, size_t size){
+	const char* end = src + n;
+	size_t i = 0;
+	while (src < end){
+		size_t literal, zeros;
+		src = getVarint(src, end, &literal);
+		if (literal > (size_t)(end - src) || i + literal > size) throw std::runtime_error("PayloadCodec: corrupt message");
+		memcpy(dst + i, src, literal);
+		src += literal;
+		i += literal;
+		src = getVarint(src, end, &zeros);
+		if (i + zeros > size) throw std::runtime_error("PayloadCodec: corrupt message");
+		memset(dst + i, 0, zeros);
+		i += zeros;
+	}
+	if (i != size) throw std::runtime_error("PayloadCodec: corrupt message");
+}
+
+/*
+ * Function: sizeClass
+ * --------------------
+ * Get the size class of a message
+ * 
+ * n: message bytes
+ *
+ * returns: floor of log2(n)
+ */
+static inline int sizeClass(size_t n){
+	int c = 0;
+	while (n >>= 1) c++;
+	return c;
+}
+
+/*
+ *    Class: PayloadCodec  
+ * Function: PayloadCodec
+ * --------------------
+ * PayloadCodec constructor
+ * 
+ * _lz4: run the zero run encoding through LZ4, ignored unless compiled with HAVE_LZ4
+ * _minBytes: shorter messages are sent raw
+ *
+ * returns: -
+ */
+PayloadCodec::PayloadCodec(bool _lz4, size_t _minBytes): lz4(_lz4 && lz4Available()), minBytes(_minBytes){
+	for (int c=0; c<64; c++)
+		skip[c] = 0;
+	resetStats();
+}
+
+/*
+ *    Class: PayloadCodec  
+ * Function: lz4Available
+ * --------------------
+ * Check if LZ4 can be used
+ * 
+ * -: -
+ *
+ * returns: true if compiled with HAVE_LZ4
+ */
+bool PayloadCodec::lz4Available(){
+#ifdef HAVE_LZ4
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ *    Class: PayloadCodec  
+ * Function: encode
+ * --------------------
+ * Encode a message, raw if it is short, its size class does not compress
+ * or the encoded one would not be shorter enough
+ * 
+ * src: message
+ * n: message bytes
+ * dst: encoded message, replaced
+ *
+ * returns: -
+ */
+void PayloadCodec::encode(const char* src, size_t n, std::vector<char>& dst){
+	double started = MPI_Wtime();
+	int c = sizeClass(n);
+	bool tried = false;
+
+	stats.messages++;
+	stats.rawBytes += n;
+	dst.resize(1 + 2 * sizeof(uint32_t) + n + n / 64 + 16);
+	if (n >= minBytes && skip[c] == 0){
+		tried = true;
+		size_t wire = 0;
+		uint32_t rawSize = n;
+		if (lz4){
+#ifdef HAVE_LZ4
+			runs.resize(n + n / 64 + 16);
+			uint32_t runsSize = encodeZeroRuns(src, n, runs.data());
+			int bound = LZ4_compressBound(runsSize);
+			dst.resize(std::max(dst.size(), 1 + 2 * sizeof(uint32_t) + bound));
+			int packed = LZ4_compress_default(runs.data(), &dst[1 + 2 * sizeof(uint32_t)], runsSize, bound);
+			if (packed > 0){
+				dst[0] = PAYLOAD_LZ4;
+				memcpy(&dst[1], &rawSize, sizeof(uint32_t));
+				memcpy(&dst[1 + sizeof(uint32_t)], &runsSize, sizeof(uint32_t));
+				wire = 1 + 2 * sizeof(uint32_t) + packed;
+			}
+#endif
+		} else {
+			dst[0] = PAYLOAD_ZERO_RUNS;
+			memcpy(&dst[1], &rawSize, sizeof(uint32_t));
+			wire = 1 + sizeof(uint32_t) + encodeZeroRuns(src, n, &dst[1 + sizeof(uint32_t)]);
+		}
+		if (wire > 0 && wire < PAYLOAD_MAX_RATIO * n){
+			dst.resize(wire);
+			stats.compressed++;
+			stats.wireBytes += wire;
+			stats.encodeTime += MPI_Wtime() - started;
+			return;
+		}
+	}
+
+	if (tried) skip[c] = PAYLOAD_RETRY;
+	else if (n >= minBytes) skip[c]--;
+	dst[0] = PAYLOAD_RAW;
+	memcpy(&dst[1], src, n);
+	dst.resize(1 + n);
+	stats.wireBytes += 1 + n;
+	stats.encodeTime += MPI_Wtime() - started;
+}
+
+/*
+ *    Class: PayloadCodec  
+ * Function: decode
+ * --------------------
+ * Decode a message written by encode
+ * 
+ * src: encoded message
+ * n: encoded bytes
+ * dst: storage of the decoded message, if it was not sent raw
+ * size: decoded bytes
+ *
+ * returns: decoded message, in src if it was sent raw
+ */
+const char* PayloadCodec::decode(const char* src, size_t n, std::vector<char>& dst, size_t* size){
+	if (n == 0){
+		*size = 0;
+		return src;
+	}
+	if (src[0] == PAYLOAD_RAW){
+		*size = n - 1;
+		return src + 1;
+	}
+
+	double started = MPI_Wtime();
+	uint32_t rawSize;
+	memcpy(&rawSize, src + 1, sizeof(uint32_t));
+	dst.resize(std::max(rawSize, (uint32_t)1));
+	if (src[0] == PAYLOAD_ZERO_RUNS){
+		decodeZeroRuns(src + 1 + sizeof(uint32_t), n - 1 - sizeof(uint32_t), dst.data(), rawSize);
+	} else {
+#ifdef HAVE_LZ4
+		uint32_t runsSize;
+		memcpy(&runsSize, src + 1 + sizeof(uint32_t), sizeof(uint32_t));
+		runs.resize(std::max(runsSize, (uint32_t)1));
+		int got = LZ4_decompress_safe(src + 1 + 2 * sizeof(uint32_t), runs.data(), n - 1 - 2 * sizeof(uint32_t), runsSize);
+		if (got != (int)runsSize) throw std::runtime_error("PayloadCodec: corrupt LZ4 message");
+		decodeZeroRuns(runs.data(), runsSize, dst.data(), rawSize);
+#else
+		throw std::runtime_error("PayloadCodec: LZ4 message, compiled without HAVE_LZ4");
+#endif
+	}
+	stats.decodeTime += MPI_Wtime() - started;
+	*size = rawSize;
+	return dst.data();
+}
+
+/*
+ *    Class: PayloadCodec  
+ * Function: resetStats
+ * --------------------
+ * Start counting a new tick
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+void PayloadCodec::resetStats(){
+	memset(&stats, 0, sizeof(stats));
+}
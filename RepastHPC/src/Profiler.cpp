@@ -0,0 +1,161 @@
+/* Profiler.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <iostream>
+#include <functional>
+#include <mpi.h>
+#include <boost/mpi/collectives.hpp>
+#include "Profiler.h"
+#include "AllocCounter.h"
+
+/*
+ *    Class: Profiler  
+ * Function: Profiler
+ * --------------------
+ * Profiler constructor
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+Profiler::Profiler(): ticks(0){
+	for (int i=0; i<NUM_PHASES; i++){
+		started[i] = 0;
+		elapsed[i] = 0;
+		startedAllocs[i] = 0;
+		startedBytes[i]  = 0;
+		allocs[i] = 0;
+		bytes[i]  = 0;
+	}
+}
+
+/*
+ *    Class: Profiler  
+ * Function: phaseName
+ * --------------------
+ * Get the name of a phase
+ * 
+ * phase: phase
+ *
+ * returns: name used in the report
+ */
+const char* Profiler::phaseName(Phase phase){
+	static const char* names[NUM_PHASES] = { "tick", "play", "compute", "move", "reproduction", "die", "sync" };
+	return names[phase];
+}
+
+/*
+ *    Class: Profiler  
+ * Function: label
+ * --------------------
+ * Add a key=value label identifying the run configuration in the report
+ * 
+ * key: label name
+ * value: label value
+ *
+ * returns: -
+ */
+void Profiler::label(std::string key, std::string value){
+	labels.push_back(key + "=" + value);
+}
+
+/*
+ *    Class: Profiler  
+ * Function: start
+ * --------------------
+ * Start timing a phase and counting its allocations
+ * 
+ * phase: phase
+ *
+ * returns: -
+ */
+void Profiler::start(Phase phase){
+	startedAllocs[phase] = AllocCounter::allocations();
+	startedBytes[phase]  = AllocCounter::bytes();
+	started[phase] = MPI_Wtime();
+}
+
+/*
+ *    Class: Profiler  
+ * Function: stop
+ * --------------------
+ * Stop timing a phase and accumulate its elapsed time and allocations
+ * 
+ * phase: phase
+ *
+ * returns: -
+ */
+void Profiler::stop(Phase phase){
+	elapsed[phase] += MPI_Wtime() - started[phase];
+	allocs[phase]  += AllocCounter::allocations() - startedAllocs[phase];
+	bytes[phase]   += AllocCounter::bytes() - startedBytes[phase];
+	if (phase == PHASE_TICK) ticks++;
+}
+
+/*
+ *    Class: Profiler  
+ * Function: report
+ * --------------------
+ * Reduce phase times over all processes. Rank 0 prints them and writes one
+ * csv row per phase with the run labels, the max and mean per process totals
+ * and the max time per tick, all in msecs, and the max heap allocations and
+ * bytes per tick of a process (0 unless compiled with ALLOC_COUNTING).
+ * 
+ * comm: mpi communicator
+ * fileName: csv output file
+ *
+ * returns: -
+ */
+void Profiler::report(boost::mpi::communicator* comm, std::string fileName){
+	double maxElapsed[NUM_PHASES], sumElapsed[NUM_PHASES];
+	unsigned long long maxAllocs[NUM_PHASES], maxBytes[NUM_PHASES];
+	int maxTicks;
+
+	boost::mpi::reduce(*comm, elapsed, NUM_PHASES, maxElapsed, boost::mpi::maximum<double>(), 0);
+	boost::mpi::reduce(*comm, elapsed, NUM_PHASES, sumElapsed, std::plus<double>(), 0);
+	boost::mpi::reduce(*comm, ticks, maxTicks, boost::mpi::maximum<int>(), 0);
+	boost::mpi::reduce(*comm, allocs, NUM_PHASES, maxAllocs, boost::mpi::maximum<unsigned long long>(), 0);
+	boost::mpi::reduce(*comm, bytes, NUM_PHASES, maxBytes, boost::mpi::maximum<unsigned long long>(), 0);
+
+	if (comm->rank() != 0) return;
+
+	std::string config;
+	for (size_t i=0; i<labels.size(); i++)
+		config += (i > 0 ? " " : "") + labels[i];
+
+	FILE *fp = fopen(fileName.c_str(), "w");
+	if (fp != NULL) fprintf(fp, "config,phase,max_msecs,mean_msecs,max_msecs_per_tick,max_allocs_per_tick,max_bytes_per_tick\n");
+	for (int i=0; i<NUM_PHASES; i++){
+		double maxMs  = maxElapsed[i] * 1000.0;
+		double meanMs = sumElapsed[i] * 1000.0 / comm->size();
+		double tickMs = (maxTicks > 0 ? maxMs / maxTicks : 0);
+		double tickAllocs = (maxTicks > 0 ? (double)maxAllocs[i] / maxTicks : 0);
+		double tickBytes  = (maxTicks > 0 ? (double)maxBytes[i] / maxTicks : 0);
+		std::cout << "Phase " << phaseName((Phase)i) << " (msecs): max " << maxMs << " mean " << meanMs << " per tick " << tickMs;
+		if (AllocCounter::enabled()) std::cout << " allocs per tick " << tickAllocs << " bytes per tick " << tickBytes;
+		std::cout << " [" << config << "]" << std::endl;
+		if (fp != NULL) fprintf(fp, "%s,%s,%.3f,%.3f,%.6f,%.1f,%.1f\n", config.c_str(), phaseName((Phase)i), maxMs, meanMs, tickMs, tickAllocs, tickBytes);
+	}
+	if (fp != NULL) fclose(fp);
+}
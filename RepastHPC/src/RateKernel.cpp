@@ -0,0 +1,152 @@
+/* RateKernel.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "RateKernel.h"
+#include "CounterRNG.h"
+#include "Agent.h"
+
+/*
+ *    Class: RateKernel  
+ * Function: rateFactors
+ * --------------------
+ * Probability at every location, rate at the center going down lineally until
+ * borders of space. Same operations as the per-agent rate factors, so the
+ * float results are the same bit for bit.
+ * 
+ * x,y: locations
+ * n: number of locations
+ * centerX,centerY: center of the rate
+ * rate: probability at the center
+ * factor: probability at every location
+ *
+ * returns: -
+ */
+void RateKernel::rateFactors(const int* __restrict__ x, const int* __restrict__ y, size_t n, int centerX, int centerY, double rate, float* __restrict__ factor){
+	const ModelParameters& params = RepastHPCAgent::getParameters();
+	const double scale = (params.height+params.width)/2;
+
+	for (size_t i=0; i<n; i++){
+		double dx = x[i] - centerX;
+		double dy = y[i] - centerY;
+		double d  = sqrt(dx*dx + dy*dy) / scale;
+		factor[i] = (float)(rate * (1 - fmin(d, 1.0)));
+	}
+}
+
+/*
+ *    Class: RateKernel  
+ * Function: uniforms
+ * --------------------
+ * Uniform draws of a stream for every key, index 0 as the per-agent draws
+ * 
+ * key: agent keys
+ * n: number of keys
+ * seed,tick: step of the draws
+ * stream: random stream
+ * u: draws
+ *
+ * returns: -
+ */
+void RateKernel::uniforms(const uint64_t* __restrict__ key, size_t n, uint32_t seed, uint32_t tick, uint32_t stream, double* __restrict__ u){
+	for (size_t i=0; i<n; i++)
+		u[i] = CounterRNG::uniform(key[i], seed, tick, stream, 0);
+}
+
+/*
+ *    Class: RateKernel  
+ * Function: pack
+ * --------------------
+ * Join the index blocks written by the threads at the start of their range
+ * 
+ * list: indexes, block t holds counts[t] entries from begins[t]
+ * counts: entries of every block
+ * begins: first position of every block
+ *
+ * returns: number of entries
+ */
+size_t RateKernel::pack(std::vector<uint32_t>& list, std::vector<size_t>& counts, std::vector<size_t>& begins){
+	size_t total = 0;
+
+	for (size_t t=0; t<counts.size(); t++){
+		if (counts[t] && begins[t] != total)
+			memmove(&list[total], &list[begins[t]], counts[t] * sizeof(uint32_t));
+		total += counts[t];
+	}
+	return total;
+}
+
+/*
+ *    Class: RateKernel  
+ * Function: evaluate
+ * --------------------
+ * Decide births and deaths of n agents, every thread of the pool takes a
+ * block: rate factors, draws and a branch free compaction of the indexes
+ * 
+ * pool: thread pool of the process
+ * key: agent keys
+ * x,y: agent locations
+ * n: number of agents
+ * seed,tick: step of the draws
+ *
+ * returns: -
+ */
+void RateKernel::evaluate(ThreadPool* pool, const uint64_t* key, const int* x, const int* y, size_t n, uint32_t seed, uint32_t tick){
+	const ModelParameters& params = RepastHPCAgent::getParameters();
+
+	birthFactor.resize(n);
+	deathFactor.resize(n);
+	birthDraw.resize(n);
+	deathDraw.resize(n);
+	births.resize(n);
+	deaths.resize(n);
+	blockBegin.assign(pool->size(), 0);
+	blockBirths.assign(pool->size(), 0);
+	blockDeaths.assign(pool->size(), 0);
+
+	pool->parallelFor(n, [&](int thread, size_t begin, size_t end){
+		size_t len = end - begin;
+
+		rateFactors(x + begin, y + begin, len, params.centerBirthX, params.centerBirthY, params.birthRate, &birthFactor[begin]);
+		rateFactors(x + begin, y + begin, len, params.centerDeathX, params.centerDeathY, params.deathRate, &deathFactor[begin]);
+		uniforms(key + begin, len, seed, tick, STREAM_REPRODUCTION, &birthDraw[begin]);
+		uniforms(key + begin, len, seed, tick, STREAM_DIE, &deathDraw[begin]);
+
+		uint32_t *b = &births[begin];
+		uint32_t *d = &deaths[begin];
+		size_t nb = 0, nd = 0;
+		for (size_t i=begin; i<end; i++){
+			b[nb] = i;
+			nb += (birthDraw[i] < birthFactor[i]);
+			d[nd] = i;
+			nd += (deathDraw[i] < deathFactor[i]);
+		}
+		blockBegin[thread]  = begin;
+		blockBirths[thread] = nb;
+		blockDeaths[thread] = nd;
+	});
+
+	births.resize(pack(births, blockBirths, blockBegin));
+	deaths.resize(pack(deaths, blockDeaths, blockBegin));
+}
@@ -0,0 +1,215 @@
+/* Scenario.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "Scenario.h"
+#include "CounterRNG.h"
+
+/*
+ *    Class: Scenario  
+ * Function: Scenario
+ * --------------------
+ * Scenario constructor, lays out the tiles and their number of agents
+ * 
+ * _p: scenario parameters
+ *
+ * returns: -
+ */
+Scenario::Scenario(const ScenarioParameters& _p): p(_p){
+	if (p.tileSize < 1) p.tileSize = 1;
+	if (p.spread <= 0) p.spread = 1;
+	if (p.distribution == SCENARIO_UNIFORM) p.background = 1;
+	p.background = std::min(std::max(p.background, 0.0), 1.0);
+	tilesX = (p.width + p.tileSize - 1) / p.tileSize;
+	tilesY = (p.height + p.tileSize - 1) / p.tileSize;
+
+	size_t n = (size_t)tilesX * tilesY;
+	double component[3] = { p.background, (1 - p.background) / 2, (1 - p.background) / 2 };
+	tileWeight.resize(n * 3);
+	first.resize(n + 1);
+
+	//Running total of the expected agents, rounded down at every tile boundary
+	double expected = 0;
+	first[0] = 0;
+	for (int ty = 0; ty < tilesY; ty++){
+		for (int tx = 0; tx < tilesX; tx++){
+			size_t t = (size_t)ty * tilesX + tx;
+			int x0 = tx * p.tileSize, x1 = std::min(x0 + p.tileSize, p.width);
+			int y0 = ty * p.tileSize, y1 = std::min(y0 + p.tileSize, p.height);
+			double mass = 0;
+			for (int k = 0; k < 3; k++){
+				tileWeight[t * 3 + k] = (component[k] > 0 ? component[k] * axisMass(k, 0, x0, x1) * axisMass(k, 1, y0, y1) : 0);
+				mass += tileWeight[t * 3 + k];
+			}
+			expected += mass * p.agents;
+			first[t + 1] = std::min(std::max((uint64_t)floor(expected + 1e-6), first[t]), p.agents);
+		}
+	}
+	first[n] = p.agents;
+}
+
+/*
+ *    Class: Scenario  
+ * Function: normalCdf
+ * --------------------
+ * Standard normal distribution function
+ * 
+ * z: value
+ *
+ * returns: P(Z < z)
+ */
+double Scenario::normalCdf(double z){
+	return 0.5 * erfc(-z * M_SQRT1_2);
+}
+
+/*
+ *    Class: Scenario  
+ * Function: axisMass
+ * --------------------
+ * Share of a component of the distribution in a range of cells of an axis.
+ * Clusters are truncated at the borders of the space.
+ * 
+ * k: component, 0: background, 1: birth cluster, 2: death cluster
+ * axis: 0: x, 1: y
+ * from,to: cells, to excluded
+ *
+ * returns: share, in [0,1]
+ */
+double Scenario::axisMass(int k, int axis, int from, int to) const{
+	int size = (axis == 0 ? p.width : p.height);
+	if (k == 0) return (double)(to - from) / size;
+
+	double c = (axis == 0 ? p.centerX[k - 1] : p.centerY[k - 1]) + 0.5;
+	double all = normalCdf((size - c) / p.spread) - normalCdf(-c / p.spread);
+	if (all <= 0) return 0;
+	return (normalCdf((to - c) / p.spread) - normalCdf((from - c) / p.spread)) / all;
+}
+
+/*
+ *    Class: Scenario  
+ * Function: fftValue
+ * --------------------
+ * Value of the FFT input vector, drawn from the stream of its index
+ * 
+ * i: index in the vector
+ * seed: scenario seed
+ * value: real and imaginary parts, uniform in [0,1)
+ *
+ * returns: -
+ */
+void Scenario::fftValue(uint64_t i, uint32_t seed, double value[2]){
+	value[0] = CounterRNG::uniform(i, seed, 0, STREAM_FFT_VECTOR, 0);
+	value[1] = CounterRNG::uniform(i, seed, 0, STREAM_FFT_VECTOR, 1);
+}
+
+/*
+ *    Class: Scenario  
+ * Function: header
+ * --------------------
+ * Header of the tiled initial state file of the scenario
+ * 
+ * h: file header
+ *
+ * returns: -
+ */
+void Scenario::header(TiledHeader& h){
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, TILED_MAGIC, sizeof(h.magic));
+	h.version = TILED_VERSION;
+	h.width = p.width;
+	h.height = p.height;
+	h.tileWidth = h.tileHeight = p.tileSize;
+	h.tilesX = tilesX;
+	h.tilesY = tilesY;
+	h.records = p.agents;
+}
+
+/*
+ *    Class: Scenario  
+ * Function: tileOf
+ * --------------------
+ * Tile of an agent
+ * 
+ * key: agent key, below the number of agents
+ *
+ * returns: tile, row major
+ */
+int Scenario::tileOf(uint64_t key) const{
+	return (int)(std::upper_bound(first.begin(), first.end(), key) - first.begin()) - 1;
+}
+
+/*
+ *    Class: Scenario  
+ * Function: generate
+ * --------------------
+ * Agents of a tile, or of a part of it. The component of an agent is drawn with the weights of
+ * the components in the tile, then every coordinate from the cells of the
+ * tile: uniformly for the background, by inverting the cumulative mass of the
+ * cells for a cluster.
+ * 
+ * t: tile, row major
+ * from,to: keys of the agents, inside [tileFirst(t), tileFirst(t+1)), to excluded
+ * out: room for to-from records, in key order
+ *
+ * returns: -
+ */
+void Scenario::generate(int t, uint64_t from, uint64_t to, TiledRecord* out) const{
+	int tx = t % tilesX, ty = t / tilesX;
+	int x0 = tx * p.tileSize, x1 = std::min(x0 + p.tileSize, p.width);
+	int y0 = ty * p.tileSize, y1 = std::min(y0 + p.tileSize, p.height);
+	int w = x1 - x0, h = y1 - y0;
+	const double* weight = &tileWeight[(size_t)t * 3];
+	double total = weight[0] + weight[1] + weight[2];
+
+	//Cumulative mass of the cells of the tile for both clusters
+	std::vector<double> cdf(2 * (w + h));
+	for (int k = 1; k < 3; k++){
+		double* cx = &cdf[(k - 1) * (w + h)];
+		double* cy = cx + w;
+		for (int i = 0; i < w; i++) cx[i] = axisMass(k, 0, x0, x0 + i + 1);
+		for (int i = 0; i < h; i++) cy[i] = axisMass(k, 1, y0, y0 + i + 1);
+	}
+
+	for (uint64_t key = from; key < to; key++){
+		TiledRecord& r = out[key - from];
+		double u = CounterRNG::uniform(key, p.seed, 0, STREAM_SCENARIO, 0) * total;
+		double ux = CounterRNG::uniform(key, p.seed, 0, STREAM_SCENARIO, 1);
+		double uy = CounterRNG::uniform(key, p.seed, 0, STREAM_SCENARIO, 2);
+		int k = (u < weight[0] ? 0 : (u < weight[0] + weight[1] || weight[2] <= 0 ? 1 : 2));
+
+		r.key = key;
+		r.id = (uint32_t)CounterRNG::bits(key, p.seed, 0, STREAM_SCENARIO, 3);
+		r.z = 0;
+		if (k == 0){
+			r.x = x0 + std::min((int)(ux * w), w - 1);
+			r.y = y0 + std::min((int)(uy * h), h - 1);
+		} else {
+			const double* cx = &cdf[(k - 1) * (w + h)];
+			const double* cy = cx + w;
+			r.x = x0 + std::min((int)(std::upper_bound(cx, cx + w, ux * cx[w - 1]) - cx), w - 1);
+			r.y = y0 + std::min((int)(std::upper_bound(cy, cy + h, uy * cy[h - 1]) - cy), h - 1);
+		}
+	}
+}
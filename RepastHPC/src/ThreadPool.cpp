@@ -0,0 +1,154 @@
+/* ThreadPool.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ThreadPool.h"
+
+static thread_local int currentThread = 0;
+
+/*
+ *    Class: ThreadPool  
+ * Function: ThreadPool
+ * --------------------
+ * ThreadPool constructor, starts nThreads-1 workers
+ * 
+ * _nThreads: number of threads including the calling one
+ *
+ * returns: -
+ */
+ThreadPool::ThreadPool(int _nThreads): nThreads(_nThreads < 1 ? 1 : _nThreads), job(nullptr), jobCall(nullptr), jobSize(0), generation(0), running(0), stopping(false){
+	for (int t=1; t<nThreads; t++)
+		workers.push_back(std::thread(&ThreadPool::work, this, t));
+}
+
+/*
+ *    Class: ThreadPool  
+ * Function: ~ThreadPool
+ * --------------------
+ * ThreadPool destructor, stops and joins the workers
+ * 
+ * -: -
+ *
+ * returns: -
+ */
+ThreadPool::~ThreadPool(){
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for (size_t t=0; t<workers.size(); t++)
+		workers[t].join();
+}
+
+/*
+ *    Class: ThreadPool  
+ * Function: current
+ * --------------------
+ * Get the index of the calling thread inside its pool
+ * 
+ * -: -
+ *
+ * returns: 0 for the main thread, 1..nThreads-1 for workers
+ */
+int ThreadPool::current(){
+	return currentThread;
+}
+
+/*
+ *    Class: ThreadPool  
+ * Function: work
+ * --------------------
+ * Worker loop, waits for a new job, runs its chunk and reports completion
+ * 
+ * thread: worker index
+ *
+ * returns: -
+ */
+void ThreadPool::work(int thread){
+	unsigned long seen = 0;
+
+	currentThread = thread;
+	while (true){
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeUp.wait(lock, [&]{ return stopping || generation != seen; });
+		if (stopping) return;
+		seen = generation;
+		lock.unlock();
+
+		runChunk(thread);
+
+		lock.lock();
+		if (--running == 0) finished.notify_one();
+	}
+}
+
+/*
+ *    Class: ThreadPool  
+ * Function: runChunk
+ * --------------------
+ * Run the static block of the current job assigned to a thread
+ * 
+ * thread: thread index
+ *
+ * returns: -
+ */
+void ThreadPool::runChunk(int thread){
+	size_t begin = jobSize * thread / nThreads;
+	size_t end   = jobSize * (thread + 1) / nThreads;
+	if (begin < end) jobCall(job, thread, begin, end);
+}
+
+/*
+ *    Class: ThreadPool  
+ * Function: run
+ * --------------------
+ * Split [0,n) into one contiguous block per thread and run the job on every
+ * block, returns when all blocks are done. Called by parallelFor(n, fn).
+ * 
+ * n: number of items
+ * fn: job object
+ * call: thunk calling the job as fn(thread, begin, end)
+ *
+ * returns: -
+ */
+void ThreadPool::run(size_t n, const void* fn, JobCall call){
+	if (nThreads == 1){
+		if (n > 0) call(fn, 0, 0, n);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = fn;
+		jobCall = call;
+		jobSize = n;
+		running = nThreads - 1;
+		generation++;
+	}
+	wakeUp.notify_all();
+
+	runChunk(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&]{ return running == 0; });
+}
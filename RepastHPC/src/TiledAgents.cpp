@@ -0,0 +1,123 @@
+/* TiledAgents.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <stdexcept>
+#include "TiledAgents.h"
+
+/*
+ * Function: keyOrder
+ * --------------------
+ * Order of the records in the text file
+ * 
+ * a,b: records
+ *
+ * returns: true if a comes before b
+ */
+static bool keyOrder(const TiledRecord& a, const TiledRecord& b){
+	return a.key < b.key;
+}
+
+/*
+ *    Class: TiledAgents  
+ * Function: read
+ * --------------------
+ * Load the agents of a process, collective over comm. The records are
+ * returned in the order of the text file, so the agents get the same
+ * ids as with the text loader.
+ * 
+ * file: tiled initial state file
+ * comm: processes loading the file
+ * xmin,ymin,xmax,ymax: bounds of the process, max excluded
+ * out: records inside the bounds
+ * header: file header, if not NULL
+ *
+ * returns: -, throws std::runtime_error if the file can not be read or is not a tiled file
+ */
+void TiledAgents::read(const std::string& file, MPI_Comm comm, int xmin, int ymin, int xmax, int ymax, std::vector<TiledRecord>& out, TiledHeader* header){
+	MPI_File fh;
+	MPI_Status status;
+	TiledHeader h;
+
+	out.clear();
+	if (MPI_File_open(comm, const_cast<char*>(file.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+		throw std::runtime_error("TiledAgents: can not open " + file);
+
+	MPI_File_read_at_all(fh, 0, &h, sizeof(h), MPI_BYTE, &status);
+	if (!tiledValid(h)){
+		MPI_File_close(&fh);
+		throw std::runtime_error("TiledAgents: " + file + " is not a tiled initial state file");
+	}
+	if (header) *header = h;
+
+	//Tiles covering the bounds, the index slice from the first one to the end of the last one
+	bool any = (xmin < xmax && ymin < ymax && xmax > 0 && ymax > 0 && xmin < h.width && ymin < h.height);
+	int tx0 = tiledClamp(xmin, h.tileWidth, h.tilesX);
+	int tx1 = tiledClamp(xmax - 1, h.tileWidth, h.tilesX);
+	int ty0 = tiledClamp(ymin, h.tileHeight, h.tilesY);
+	int ty1 = tiledClamp(ymax - 1, h.tileHeight, h.tilesY);
+	uint64_t first = (uint64_t)ty0 * h.tilesX + tx0;
+	uint64_t last  = (uint64_t)ty1 * h.tilesX + tx1 + 1;
+	std::vector<uint64_t> index(any ? last - first + 1 : 0);
+
+	MPI_File_read_at_all(fh, tiledIndexOffset() + first * sizeof(uint64_t), index.data(), (int)index.size(), MPI_UINT64_T, &status);
+
+	//One block of records per row of tiles
+	MPI_Datatype recordType, fileType;
+	std::vector<int> blocks;
+	std::vector<MPI_Aint> displacements;
+	uint64_t records = 0;
+
+	for (int ty = ty0; any && ty <= ty1; ty++){
+		uint64_t begin = index[(uint64_t)ty * h.tilesX + tx0 - first];
+		uint64_t end   = index[(uint64_t)ty * h.tilesX + tx1 + 1 - first];
+		if (end <= begin) continue;
+		blocks.push_back((int)(end - begin));
+		displacements.push_back((MPI_Aint)(tiledRecordsOffset(h) + begin * sizeof(TiledRecord)));
+		records += end - begin;
+	}
+
+	MPI_Type_contiguous(sizeof(TiledRecord), MPI_BYTE, &recordType);
+	MPI_Type_commit(&recordType);
+	if (blocks.empty()){
+		fileType = recordType;
+	} else {
+		MPI_Type_create_hindexed((int)blocks.size(), blocks.data(), displacements.data(), recordType, &fileType);
+		MPI_Type_commit(&fileType);
+	}
+
+	out.resize(records);
+	MPI_File_set_view(fh, 0, recordType, fileType, const_cast<char*>("native"), MPI_INFO_NULL);
+	MPI_File_read_all(fh, out.data(), (int)records, recordType, &status);
+	MPI_File_close(&fh);
+
+	if (fileType != recordType) MPI_Type_free(&fileType);
+	MPI_Type_free(&recordType);
+
+	//Border tiles stick out of the bounds
+	size_t kept = 0;
+	for (size_t i=0; i<out.size(); i++)
+		if (out[i].x >= xmin && out[i].x < xmax && out[i].y >= ymin && out[i].y < ymax) out[kept++] = out[i];
+	out.resize(kept);
+	std::sort(out.begin(), out.end(), keyOrder);
+}
@@ -0,0 +1,161 @@
+/* convert_init.cpp */
+/* 
+* Benchmark model for Repast HPC ABMS
+* This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/xxxx).
+* Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+* 
+*Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+*A survey on parallel and distributed multi-agent systems for high performance comput-
+*ing simulations Computer Science Review 22 (2016) 27–46
+*
+* This program is free software: you can redistribute it and/or modify  
+* it under the terms of the GNU General Public License as published by  
+* the Free Software Foundation, version 3.
+*
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of 
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+* General Public License for more details.
+* 
+*  You should have received a copy of the GNU General Public License 
+*  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "TiledFormat.h"
+#include "FFTVectorFormat.h"
+
+
+using namespace std; 
+/*
+ * Function:  convertFFT 
+ * --------------------
+ * Conversion of a fft.data text FFT vector file to the binary format mapped
+ * by the Repast HPC model (initial.fft.vector.format = binary)
+ *
+ * textFile: FFT vector written by gen_file_init, N then "re im" per line
+ * binaryFile: output file
+ *
+ * returns: 0, 1 on error
+*/
+
+static int convertFFT(const char* textFile, const char* binaryFile) {
+	FILE* fp = fopen(textFile, "r");
+	int N;
+	if (fp == NULL || fscanf(fp, "%d", &N) != 1 || N < 1) {
+		fprintf(stderr, "Can not read the vector size of %s\n", textFile);
+		if (fp) fclose(fp);
+		return 1;
+	}
+	vector<double> values(2 * (size_t)N, 0.0);
+	for (int i = 0; i < N; i++)
+		if (fscanf(fp, "%lf %lf", &values[2 * i], &values[2 * i + 1]) != 2) break;
+	fclose(fp);
+
+	FFTVectorHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, FFT_VECTOR_MAGIC, sizeof(h.magic));
+	h.version = FFT_VECTOR_VERSION;
+	h.N = N;
+
+	fp = fopen(binaryFile, "wb");
+	if (fp == NULL) {
+		fprintf(stderr, "Can not create %s\n", binaryFile);
+		return 1;
+	}
+	bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(values.data(), sizeof(double), values.size(), fp) == values.size();
+	if (fclose(fp) != 0 || !ok) {
+		fprintf(stderr, "Error writing %s\n", binaryFile);
+		return 1;
+	}
+
+	printf("%d FFT values\n", N);
+	return 0;
+}
+
+/*
+ * Function:  main 
+ * --------------------
+ * Conversion of a 0.data text initial state file to the tiled binary format
+ * loaded in parallel by the Repast HPC model (initial.agents.format = tiles)
+ * Execute: ./convert_init  text_file tiled_file width height tile_size
+ *          ./convert_init  -fft fft_text_file fft_binary_file
+ *
+ * text_file: initial state written by gen_file_init, "id x y z" per line
+ * tiled_file: output file
+ * width, height: size of the space, model.width and model.height
+ * tile_size: side of the tiles, a process reads the rows of tiles covering its bounds
+ * -fft: convert the FFT vector file instead (see convertFFT)
+ *
+ * returns: 0, 1 on error
+ * 	    tiled_file with the agents sorted by tile
+*/
+
+int main(int argc, char *argv[]) { 
+	if (argc == 4 && strcmp(argv[1], "-fft") == 0) return convertFFT(argv[2], argv[3]);
+	if (argc < 6) {
+		fprintf(stderr, "Usage: %s text_file tiled_file width height tile_size\n       %s -fft fft_text_file fft_binary_file\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	TiledHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, TILED_MAGIC, sizeof(h.magic));
+	h.version = TILED_VERSION;
+	h.width = atoi(argv[3]);
+	h.height = atoi(argv[4]);
+	h.tileWidth = h.tileHeight = atoi(argv[5]);
+	if (h.width < 1 || h.height < 1 || h.tileWidth < 1) {
+		fprintf(stderr, "width, height and tile_size must be positive\n");
+		return 1;
+	}
+	h.tilesX = (h.width + h.tileWidth - 1) / h.tileWidth;
+	h.tilesY = (h.height + h.tileHeight - 1) / h.tileHeight;
+
+	FILE* fp = fopen(argv[1], "r");
+	if (fp == NULL) {
+		fprintf(stderr, "Can not open %s\n", argv[1]);
+		return 1;
+	}
+
+	//The line of an agent is its key, as in the text loader of the model
+	vector<TiledRecord> agents;
+	TiledRecord r;
+	for (r.key = 0; fscanf(fp, "%u %d %d %d", &r.id, &r.x, &r.y, &r.z) == 4; r.key++)
+		agents.push_back(r);
+	fclose(fp);
+	h.records = agents.size();
+
+	//Counting sort by tile, stable so the records of a tile keep the file order
+	size_t tiles = (size_t)h.tilesX * h.tilesY;
+	vector<uint64_t> index(tiles + 1, 0);
+	vector<size_t> tileOf(agents.size());
+	for (size_t i = 0; i < agents.size(); i++) {
+		tileOf[i] = (size_t)tiledClamp(agents[i].y, h.tileHeight, h.tilesY) * h.tilesX + tiledClamp(agents[i].x, h.tileWidth, h.tilesX);
+		index[tileOf[i] + 1]++;
+	}
+	for (size_t t = 0; t < tiles; t++) index[t + 1] += index[t];
+
+	vector<TiledRecord> sorted(agents.size());
+	vector<uint64_t> next(index.begin(), index.end() - 1);
+	for (size_t i = 0; i < agents.size(); i++) sorted[next[tileOf[i]]++] = agents[i];
+
+	fp = fopen(argv[2], "wb");
+	if (fp == NULL) {
+		fprintf(stderr, "Can not create %s\n", argv[2]);
+		return 1;
+	}
+	bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+	          fwrite(index.data(), sizeof(uint64_t), index.size(), fp) == index.size() &&
+	          fwrite(sorted.data(), sizeof(TiledRecord), sorted.size(), fp) == sorted.size();
+	if (fclose(fp) != 0 || !ok) {
+		fprintf(stderr, "Error writing %s\n", argv[2]);
+		return 1;
+	}
+
+	printf("%llu agents in %d x %d tiles of %d x %d\n", (unsigned long long)h.records, h.tilesX, h.tilesY, h.tileWidth, h.tileHeight);
+	return 0; 
+} 
@@ -1,128 +1,272 @@
-/* 
- * Generation 0.xml file for benchmark FLAME ABMS model
- * This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/HPCA4SE-UAB/ABMS-Benchmark-FLAME.git).
- * Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
- *
- *Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
- *A survey on parallel and distributed multi-agent systems for high performance comput-
- *ing simulations Computer Science Review 22 (2016) 27–46
- *
- * This program is free software: you can redistribute it and/or modify  
- * it under the terms of the GNU General Public License as published by  
- * the Free Software Foundation, version 3.
- *
- * This program is distributed in the hope that it will be useful, but 
- * WITHOUT ANY WARRANTY; without even the implied warranty of 
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
- * General Public License for more details.
-  
- *  You should have received a copy of the GNU General Public License 
- *  along with this program. If not, see <http://www.gnu.org/licenses/>.
- */
-
-
-#include <stdio.h>
-#include <fstream>
-#include <iostream>
-#include <ios> 
-#include <stdlib.h>  
-#include <math.h>
-#include <string.h>
-#include <uuid/uuid.h>
-extern "C"{
-#include "fnv.h"
-}
-
-
-using namespace std; 
-/*
- * Function:  main 
- * --------------------
- * Generation 0.xml file for benchmark FLAME ABMS model
- * Execute: ./get_file_init  num_persons birth_rate death_rate
- *
- * num_persons: number of agents
- * birth_rate: birth probability, inteval [0,1], 0: no birth, 1: 100% probability of birth
- * death_rate: death probability, inteval [0,1], 0: no death, 1: 100% probability of death
- *
- * returns: 0
- * 	    0.xml file for FLAME
-*/
-
-int main(int argc, char *argv[]) { 
-	ofstream objetfichier, objetfichier2, objetfichier3;
-
-	uuid_t uuid;
-	Fnv32_t hash_val;
-
-	objetfichier.open("0.xml", ios::out); 
-	objetfichier2.open("0.data", ios::out); 
-	srand (time(NULL));
-	int num_persons;
-	num_persons = atoi(argv[1]);
-	float birth_rate;
-	birth_rate = atof(argv[2]);
-	float death_rate;
-	death_rate = atof(argv[3]);
-	
-	// creating the structure of the XML 
-	objetfichier << "<states>" << "\n";
-	objetfichier << "<itno>0</itno>" << "\n";
-
-	objetfichier << "<environment>" << "\n";
-	objetfichier << "	<height>300</height>" << "\n";
-	objetfichier << "	<width>300</width>" << "\n";
-	objetfichier << "	<radius>10</radius>" << "\n";
-	objetfichier << "	<birth_rate>"<<birth_rate <<"</birth_rate>" << "\n";
-	objetfichier << "	<center_birth_x>"<<150<<"</center_birth_x>" << "\n";
-	objetfichier << "	<center_birth_y>"<<150<<"</center_birth_y>" << "\n";
-	objetfichier << "	<death_rate>"<< death_rate <<"</death_rate>" << "\n";
-	objetfichier << "	<center_death_x>"<<50<<"</center_death_x>" << "\n";
-	objetfichier << "	<center_death_y>"<<50<<"</center_death_y>" << "\n";
-	objetfichier << "</environment>" << "\n";
-	
-	objetfichier << "<agents>" << "\n";
-
-	// Creating agent 
-	for(int i=1; i<=num_persons; i++) {
-		int x = rand()%(299-0);
-		int y = rand()%(299-0);
-		//int z = rand()%(299-0);
-		int z = 0;
-		objetfichier << "<xagent>" << "\n";
-		objetfichier << "	<name>person</name>" << "\n";
-		
-		uuid_generate(uuid);
-
-		hash_val = fnv_32_buf(uuid, 16, FNV1_32_INIT);
-		objetfichier << "	<id>" << hash_val  <<"</id>" << "\n";
-		objetfichier << "	<x>" << x << "</x>" << "\n";
-		objetfichier << "	<y>" << y << "</y>" << "\n";
-		objetfichier << "       <z>" << z << "</z>" << "\n";
-		objetfichier2 << hash_val << " " << x << " " << y << " " << z << "\n";
-		objetfichier << "	<c>100</c>" << "\n";
-		objetfichier << "	<total>200</total>" << "\n";		
-		objetfichier << "</xagent>" << "\n";
-	}
-	
-	objetfichier << "</agents>" << "\n";
-	objetfichier << "</states>" << "\n";
-
-	objetfichier.close();  
-	objetfichier2.close();  
-
-	//  Creating FFT vector fille
-	objetfichier3.open("fft.data", ios::out);
-
-	int fft_vector_size = atof(argv[4]);
-	objetfichier3 << fft_vector_size << "\n";
-
-       for(int i=1; i <= fft_vector_size; i++) {
-                 objetfichier3 << ((double)rand()/(RAND_MAX)) << " " << ((double)rand()/(RAND_MAX)) << "\n";
-	}
-
-	objetfichier3.close();
-	
-	return 0; 
-} 
-
+/* 
+ * Generation 0.xml file for benchmark FLAME ABMS model
+ * This file is part of the ABMS-Benchmark-FLAME distribution (https://github.com/HPCA4SE-UAB/ABMS-Benchmark-FLAME.git).
+ * Copyright (c) 2018 Universitat Autònoma de Barcelona, Escola Universitària Salesiana de Sarrià
+ *
+ *Based on: Alban Rousset, Bénédicte Herrmann, Christophe Lang, Laurent Philippe
+ *A survey on parallel and distributed multi-agent systems for high performance comput-
+ *ing simulations Computer Science Review 22 (2016) 27–46
+ *
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+  
+ *  You should have received a copy of the GNU General Public License 
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include "Scenario.h"
+#include "FFTVectorFormat.h"
+#include "ThreadPool.h"
+
+//Records generated, and formatted as text, between two writes
+#define GEN_CHUNK_RECORDS (1 << 22)
+
+
+using namespace std; 
+
+/* Output files of the generator */
+struct GenOutput {
+	FILE*	tiles;	// 0.tiles, tiled binary initial state
+	FILE*	data;	// 0.data, text initial state, NULL if not asked for
+	FILE*	xml;	// 0.xml, FLAME initial state, NULL if not asked for
+};
+
+/*
+ * Function:  formatAgents 
+ * --------------------
+ * Text of a range of agents, for 0.data and 0.xml
+ *
+ * r: records
+ * n: number of records
+ * xml: true for FLAME xagent elements, false for "id x y z" lines
+ * out: text, appended
+ *
+ * returns: -
+*/
+
+static void formatAgents(const TiledRecord* r, size_t n, bool xml, string& out) {
+	char line[256];
+	for (size_t i = 0; i < n; i++) {
+		int len;
+		if (xml)
+			len = snprintf(line, sizeof(line), "<xagent>\n\t<name>person</name>\n\t<id>%u</id>\n\t<x>%d</x>\n\t<y>%d</y>\n       <z>%d</z>\n\t<c>100</c>\n\t<total>200</total>\n</xagent>\n",
+			               r[i].id, r[i].x, r[i].y, r[i].z);
+		else
+			len = snprintf(line, sizeof(line), "%u %d %d %d\n", r[i].id, r[i].x, r[i].y, r[i].z);
+		out.append(line, len);
+	}
+}
+
+/*
+ * Function:  writeAgents 
+ * --------------------
+ * Generation of the agents in chunks of GEN_CHUNK_RECORDS keys. The threads
+ * of the pool generate (and format) a contiguous part of the chunk each, the
+ * main thread writes it in key order.
+ *
+ * s: scenario
+ * pool: threads
+ * out: output files, the tiled file positioned after its index
+ * agents: number of agents
+ *
+ * returns: true if every write succeeded
+*/
+
+static bool writeAgents(Scenario& s, ThreadPool& pool, GenOutput& out, uint64_t agents) {
+	vector<TiledRecord> records;
+	vector<string> text(pool.size()), xml(pool.size());
+	bool ok = true;
+
+	for (uint64_t chunk = 0; chunk < agents; chunk += GEN_CHUNK_RECORDS) {
+		uint64_t chunkEnd = min(agents, chunk + GEN_CHUNK_RECORDS);
+		records.resize(chunkEnd - chunk);
+
+		pool.parallelFor(chunkEnd - chunk, [&](int thread, size_t begin, size_t end) {
+			uint64_t key = chunk + begin, last = chunk + end;
+			for (int t = s.tileOf(key); key < last; t++) {
+				uint64_t to = min(last, s.tileFirst(t) + s.tileCount(t));
+				if (to > key) s.generate(t, key, to, &records[key - chunk]);
+				key = max(key, to);
+			}
+			if (out.data) { text[thread].clear(); formatAgents(&records[begin], end - begin, false, text[thread]); }
+			if (out.xml) { xml[thread].clear(); formatAgents(&records[begin], end - begin, true, xml[thread]); }
+		});
+
+		ok = ok && fwrite(records.data(), sizeof(TiledRecord), records.size(), out.tiles) == records.size();
+		for (int t = 0; t < pool.size(); t++) {
+			//A thread given no agents keeps the text of the chunk before
+			size_t begin = records.size() * t / pool.size(), end = records.size() * (t + 1) / pool.size();
+			if (begin == end) continue;
+			if (out.data) ok = ok && fwrite(text[t].data(), 1, text[t].size(), out.data) == text[t].size();
+			if (out.xml) ok = ok && fwrite(xml[t].data(), 1, xml[t].size(), out.xml) == xml[t].size();
+		}
+	}
+	return ok;
+}
+
+/*
+ * Function:  writeFFT 
+ * --------------------
+ * Generation of the FFT input vector, fft.bin and, if asked for, fft.data
+ *
+ * N: vector size
+ * seed: scenario seed
+ * pool: threads
+ * text: true to write fft.data too
+ *
+ * returns: true if every write succeeded
+*/
+
+static bool writeFFT(int N, uint32_t seed, ThreadPool& pool, bool text) {
+	vector<double> values(2 * (size_t)N);
+	pool.parallelFor(N, [&](int, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) Scenario::fftValue(i, seed, &values[2 * i]);
+	});
+
+	FFTVectorHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, FFT_VECTOR_MAGIC, sizeof(h.magic));
+	h.version = FFT_VECTOR_VERSION;
+	h.N = N;
+	FILE* fp = fopen("fft.bin", "wb");
+	if (fp == NULL) return false;
+	bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(values.data(), sizeof(double), values.size(), fp) == values.size();
+	ok = (fclose(fp) == 0) && ok;
+
+	if (text) {
+		fp = fopen("fft.data", "w");
+		if (fp == NULL) return false;
+		fprintf(fp, "%d\n", N);
+		for (int i = 0; i < N; i++) fprintf(fp, "%.17g %.17g\n", values[2 * i], values[2 * i + 1]);
+		ok = (fclose(fp) == 0) && ok;
+	}
+	return ok;
+}
+
+/*
+ * Function:  main 
+ * --------------------
+ * Generation of the initial state for benchmark ABMS models, seeded and multithreaded
+ * Execute: ./gen_file_init  [options] num_persons birth_rate death_rate fft_vector_size
+ *
+ * num_persons: number of agents
+ * birth_rate: birth probability, inteval [0,1], 0: no birth, 1: 100% probability of birth
+ * death_rate: death probability, inteval [0,1], 0: no death, 1: 100% probability of death
+ * fft_vector_size: FFT vector size
+ *
+ * options:
+ * -seed s: scenario seed, same seed same files (default 1)
+ * -threads t: generator threads (default all the hardware threads)
+ * -dist uniform|clustered: positions uniform in the space, or Gaussian clusters
+ *     around the birth and death centers over a uniform background (default uniform)
+ * -spread s: standard deviation of the clusters (default 30)
+ * -background b: fraction of the agents spread uniformly with clustered (default 0.2)
+ * -size w h: space size, model.width and model.height (default 300 300)
+ * -centers bx by dx dy: birth and death centers (default 150 150 50 50)
+ * -tile t: tile side of 0.tiles (default 64)
+ * -text: write 0.data and fft.data too, text files for the text loaders
+ * -xml: write 0.xml too, for FLAME
+ *
+ * returns: 0, 1 on error
+ * 	    0.tiles, tiled initial state for Repast HPC (initial.agents.format = tiles)
+ * 	    fft.bin, FFT vector (initial.fft.vector.format = binary)
+*/
+
+int main(int argc, char *argv[]) { 
+	ScenarioParameters p;
+	memset(&p, 0, sizeof(p));
+	p.width = p.height = 300;
+	p.tileSize = 64;
+	p.seed = 1;
+	p.distribution = SCENARIO_UNIFORM;
+	p.spread = 30;
+	p.background = 0.2;
+	p.centerX[0] = p.centerY[0] = 150;
+	p.centerX[1] = p.centerY[1] = 50;
+	int threads = max(1, (int)thread::hardware_concurrency());
+	bool text = false, xml = false;
+
+	int a = 1;
+	for (; a < argc && argv[a][0] == '-'; a++) {
+		string o = argv[a];
+		int left = argc - a - 1;
+		if (o == "-seed" && left >= 1) p.seed = strtoul(argv[++a], NULL, 10);
+		else if (o == "-threads" && left >= 1) threads = max(1, atoi(argv[++a]));
+		else if (o == "-dist" && left >= 1) p.distribution = (string(argv[++a]) == "clustered" ? SCENARIO_CLUSTERED : SCENARIO_UNIFORM);
+		else if (o == "-spread" && left >= 1) p.spread = atof(argv[++a]);
+		else if (o == "-background" && left >= 1) p.background = atof(argv[++a]);
+		else if (o == "-size" && left >= 2) { p.width = atoi(argv[++a]); p.height = atoi(argv[++a]); }
+		else if (o == "-centers" && left >= 4) {
+			p.centerX[0] = atoi(argv[++a]); p.centerY[0] = atoi(argv[++a]);
+			p.centerX[1] = atoi(argv[++a]); p.centerY[1] = atoi(argv[++a]);
+		}
+		else if (o == "-tile" && left >= 1) p.tileSize = atoi(argv[++a]);
+		else if (o == "-text") text = true;
+		else if (o == "-xml") xml = true;
+		else { fprintf(stderr, "Unknown option %s\n", argv[a]); return 1; }
+	}
+	if (argc - a < 4 || p.width < 1 || p.height < 1) {
+		fprintf(stderr, "Usage: %s [options] num_persons birth_rate death_rate fft_vector_size\n", argv[0]);
+		return 1;
+	}
+	p.agents = strtoull(argv[a], NULL, 10);
+	float birth_rate = atof(argv[a + 1]);
+	float death_rate = atof(argv[a + 2]);
+	int fft_vector_size = atoi(argv[a + 3]);
+
+	Scenario s(p);
+	ThreadPool pool(threads);
+	GenOutput out;
+	out.tiles = fopen("0.tiles", "wb");
+	out.data = (text ? fopen("0.data", "w") : NULL);
+	out.xml = (xml ? fopen("0.xml", "w") : NULL);
+	if (out.tiles == NULL || (text && out.data == NULL) || (xml && out.xml == NULL)) {
+		fprintf(stderr, "Can not create the output files\n");
+		return 1;
+	}
+
+	// creating the structure of the XML 
+	if (out.xml) {
+		fprintf(out.xml, "<states>\n<itno>0</itno>\n<environment>\n");
+		fprintf(out.xml, "\t<height>%d</height>\n\t<width>%d</width>\n\t<radius>10</radius>\n", p.height, p.width);
+		fprintf(out.xml, "\t<birth_rate>%g</birth_rate>\n\t<center_birth_x>%d</center_birth_x>\n\t<center_birth_y>%d</center_birth_y>\n", birth_rate, p.centerX[0], p.centerY[0]);
+		fprintf(out.xml, "\t<death_rate>%g</death_rate>\n\t<center_death_x>%d</center_death_x>\n\t<center_death_y>%d</center_death_y>\n", death_rate, p.centerX[1], p.centerY[1]);
+		fprintf(out.xml, "</environment>\n<agents>\n");
+	}
+
+	TiledHeader h;
+	s.header(h);
+	bool ok = fwrite(&h, sizeof(h), 1, out.tiles) == 1 &&
+	          fwrite(s.index().data(), sizeof(uint64_t), s.index().size(), out.tiles) == s.index().size();
+	ok = writeAgents(s, pool, out, p.agents) && ok;
+
+	if (out.xml) {
+		fprintf(out.xml, "</agents>\n</states>\n");
+		ok = (fclose(out.xml) == 0) && ok;
+	}
+	if (out.data) ok = (fclose(out.data) == 0) && ok;
+	ok = (fclose(out.tiles) == 0) && ok;
+
+	//  Creating FFT vector fille
+	ok = writeFFT(fft_vector_size, p.seed, pool, text) && ok;
+
+	if (!ok) {
+		fprintf(stderr, "Error writing the output files\n");
+		return 1;
+	}
+	printf("%llu agents in %d x %d tiles, %d FFT values, seed %u\n", (unsigned long long)p.agents, s.tilesPerRow(), s.tileRows(), fft_vector_size, p.seed);
+	return 0; 
+} 